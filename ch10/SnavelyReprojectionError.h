@@ -20,7 +20,7 @@ public:
     bool operator()(const T *const camera, const T *const point, T *residuals) const {
 //        camera[0,1,2] are the angle-axis rotation
         T predictions[2];
-        CamProjectionWithDistortion(camera, point, residuals);
+        CamProjectionWithDistortion(camera, point, predictions);
         residuals[0] = predictions[0] - T(observed_x);
         residuals[1] = predictions[1] - T(observed_y);
         return true;
@@ -32,4 +32,30 @@ public:
     }
 };
 
+//    the same residual with hand written derivatives, which saves evaluating the projection on Jets
+class SnavelyReprojectionErrorAnalytic : public ceres::SizedCostFunction<2, 9, 3> {
+private:
+    double observed_x;
+    double observed_y;
+public:
+    SnavelyReprojectionErrorAnalytic(double observation_x, double observation_y) :
+            observed_x(observation_x), observed_y(observation_y) {}
+
+//    jacobians[0] is the 2x9 camera block and jacobians[1] the 2x3 point block, both row-major,
+//    ceres passes NULL for the ones it does not need, e.g. those of constant blocks
+    virtual bool Evaluate(double const *const *parameters, double *residuals, double **jacobians) const {
+        double predictions[2];
+        CamProjectionWithDistortionJacobian(parameters[0], parameters[1], predictions,
+                                            jacobians != NULL ? jacobians[0] : NULL,
+                                            jacobians != NULL ? jacobians[1] : NULL);
+        residuals[0] = predictions[0] - observed_x;
+        residuals[1] = predictions[1] - observed_y;
+        return true;
+    }
+
+    static ceres::CostFunction *Create(const double observed_x, const double observed_y) {
+        return new SnavelyReprojectionErrorAnalytic(observed_x, observed_y);
+    }
+};
+
 #endif //SLAMBOOK_SNAVELYREPROJECTIONERROR_H
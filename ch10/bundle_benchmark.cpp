@@ -0,0 +1,93 @@
+//
+// Created by Left Thomas on 2017/9/20.
+//
+
+#include <iostream>
+#include <cstdio>
+#include "common/BALProblem.h"
+#include "common/BundleParams.h"
+#include "common/BundleAdjuster.h"
+#include "common/BundleProblem.h"
+using namespace std;
+using namespace ceres;
+
+// 在同一个BAL文件上对比ceres与原生求解器, 参数与ceres_bundle相同, 例如:
+// -input ../data/problem-16-22106-pre.txt -linear_solver sparse_schur -num_threads 4 -num_iterations 20
+
+
+struct Result {
+    int iterations;
+    double seconds;
+    double initial_cost;
+    double final_cost;
+};
+
+Result SolveWithCeres(const BundleParams &params) {
+    BALProblem bal_problem(params.input, false, !params.no_cache);
+    PerturbProblem(&bal_problem, params);
+    Problem problem;
+    BuildProblem(&bal_problem, &problem, params);
+
+    Solver::Options options;
+    setSolverOptionsFromFlags(&bal_problem, params, &options);
+    options.gradient_tolerance = 1e-16;
+    options.function_tolerance = 1e-16;
+    Solver::Summary summary;
+    ceres::Solve(options, &problem, &summary);
+
+    Result result;
+    result.iterations = summary.iterations.size() - 1;
+    result.seconds = summary.total_time_in_seconds;
+    result.initial_cost = summary.initial_cost;
+    result.final_cost = summary.final_cost;
+    return result;
+}
+
+Result SolveNative(const BundleParams &params) {
+    BALProblem bal_problem(params.input, false, !params.no_cache);
+    PerturbProblem(&bal_problem, params);
+
+    BundleAdjuster::Options options;
+    options.max_num_iterations = params.num_iterations;
+    options.num_threads = params.num_threads;
+    options.linear_solver = params.linear_solver;
+    options.preconditioner = params.preconditioner;
+    options.eta = params.eta;
+    options.robustify = params.robustify;
+    options.gradient_tolerance = 1e-16;
+    options.function_tolerance = 1e-16;
+    BundleAdjuster adjuster(&bal_problem);
+    BundleAdjuster::Summary summary;
+    if (!adjuster.Solve(options, &summary))
+        cerr << summary.termination << endl;
+
+    Result result;
+    result.iterations = summary.iterations.size() - 1;
+    result.seconds = summary.total_time;
+    result.initial_cost = summary.initial_cost;
+    result.final_cost = summary.final_cost;
+    return result;
+}
+
+int main(int argc, char **argv) {
+    BundleParams params(argc, argv);
+    if (params.input.empty()) {
+        cout << "Usage: bundle_benchmark -input <path for dataset> "
+                "[-linear_solver dense_schur|sparse_schur|iterative_schur]" << endl;
+        return 1;
+    }
+
+    Result ceres = SolveWithCeres(params);
+    Result native = SolveNative(params);
+
+    printf("\n%-8s %10s %12s %16s %16s %12s\n", "solver", "iterations", "seconds", "initial cost", "final cost",
+           "ms/iteration");
+    const Result *results[] = {&ceres, &native};
+    const char *names[] = {"ceres", "native"};
+    for (int k = 0; k < 2; ++k) {
+        const Result &r = *results[k];
+        printf("%-8s %10d %12.3f %16.6e %16.6e %12.3f\n", names[k], r.iterations, r.seconds, r.initial_cost,
+               r.final_cost, 1000.0 * r.seconds / max(r.iterations, 1));
+    }
+    return 0;
+}
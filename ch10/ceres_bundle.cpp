@@ -1,7 +1,10 @@
 #include<iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include "common/BALProblem.h"
 #include "common/BundleParams.h"
-#include "SnavelyReprojectionError.h"
+#include "common/BundleProblem.h"
 using namespace std;
 using namespace ceres;
 
@@ -9,69 +12,47 @@ using namespace ceres;
 // -input ../../ch10/data/problem-16-22106-pre.txt -initial_ply ../../ch10/data/initial.ply -final_ply ../../ch10/data/final.ply
 
 
-void BuildProblem(BALProblem *bal_problem, Problem *problem, const BundleParams &params) {
-    const int point_block_size = bal_problem->point_block_size();
-    const int camera_block_size = bal_problem->camera_block_size();
-    double *points = bal_problem->mutable_points();
-    double *cameras = bal_problem->mutable_cameras();
-//    observations is 2*num_observations long array observations
-//    [u_1,u_2,...,u_n], where each u_i is two dimensional, the x and y position of the observation.
-    const double *observations = bal_problem->observations();
-
-    for (int i = 0; i < bal_problem->num_observations(); ++i) {
-        CostFunction *cost_function;
-//        each residual block takes a point and camera as input
-//        and outputs a 2 dimensional residual
-        cost_function = SnavelyReprojectionError::Create(observations[2 * i + 0], observations[2 * i + 1]);
-//        if enabled use Huber's loss function
-        LossFunction *loss_function = params.robustify ? new HuberLoss(1.0) : nullptr;
-//        each observation corresponds to a pair of a camera and a point
-//        which are identified by camera_index()[i] and point_index()[i] respectively
-        double *camera = cameras + camera_block_size * bal_problem->camera_index()[i];
-        double *point = points + point_block_size * bal_problem->point_index()[i];
-
-        problem->AddResidualBlock(cost_function, loss_function, camera, point);
+//    solves the problem once with every ordering, each time from the same perturbed start
+void compareOrderings(const BundleParams &params) {
+    struct Run {
+        string ordering;
+        double ordering_time, total_time, linear_solver_time, final_cost;
+        int iterations;
+    };
+    vector<Run> runs;
+    for (const char *ordering_type : ORDERINGS) {
+        BALProblem bal_problem(params.input, false, !params.no_cache);
+        PerturbProblem(&bal_problem, params);
+        Problem problem;
+        BuildProblem(&bal_problem, &problem, params);
+
+        Solver::Options options;
+        setSolverOptionsFromFlags(&bal_problem, params, &options);
+        options.minimizer_progress_to_stdout = false;
+        options.gradient_tolerance = 1e-16;
+        options.function_tolerance = 1e-16;
+        auto start = chrono::steady_clock::now();
+        setOrdering(&bal_problem, &options, ordering_type);
+        double ordering_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        Solver::Summary summary;
+        ceres::Solve(options, &problem, &summary);
+        cout << ordering_type << ": " << summary.BriefReport() << endl;
+
+        Run run;
+        run.ordering = ordering_type;
+        run.ordering_time = ordering_time;
+        run.total_time = summary.total_time_in_seconds;
+        run.linear_solver_time = summary.linear_solver_time_in_seconds;
+        run.final_cost = summary.final_cost;
+        run.iterations = summary.iterations.size() - 1;
+        runs.push_back(run);
     }
-}
 
-void setOrdering(BALProblem *bal_problem, Solver::Options *options, const BundleParams &params) {
-    const int num_points = bal_problem->num_points();
-    const int point_block_size = bal_problem->point_block_size();
-    double *points = bal_problem->mutable_points();
-    const int num_cameras = bal_problem->num_cameras();
-    const int cameras_block_size = bal_problem->camera_block_size();
-    double *cameras = bal_problem->mutable_cameras();
-
-    if (params.ordering == "automatic")
-        return;
-    auto *ordering = new ParameterBlockOrdering;
-//    the points come before the cameras
-    for (int i = 0; i < num_points; ++i) {
-        ordering->AddElementToGroup(points + point_block_size * i, 0);
-    }
-    for (int i = 0; i < num_cameras; ++i) {
-        ordering->AddElementToGroup(cameras + cameras_block_size * i, 1);
-    }
-    options->linear_solver_ordering.reset();
-}
-
-void setSolverOptionsFromFlags(BALProblem *bal_problem, const BundleParams &params, Solver::Options *options) {
-    options->max_num_iterations = params.num_iterations;
-    options->minimizer_progress_to_stdout = true;
-    options->num_threads = params.num_threads;
-
-//    选取下降策略
-    CHECK(StringToTrustRegionStrategyType(params.trust_region_strategy, &options->trust_region_strategy_type));
-
-//    选取linear solver
-    CHECK(StringToLinearSolverType(params.linear_solver, &options->linear_solver_type));
-    CHECK(StringToSparseLinearAlgebraLibraryType(params.sparse_linear_algebra_library,
-                                                 &options->sparse_linear_algebra_library_type));
-    CHECK(StringToDenseLinearAlgebraLibraryType(params.dense_linear_algebra_library,
-                                                &options->dense_linear_algebra_library_type));
-
-//    设置变量排序
-    setOrdering(bal_problem, options, params);
+    printf("\n%-18s %10s %12s %14s %12s %16s\n", "ordering", "iterations", "ordering s", "linear solver s",
+           "total s", "final cost");
+    for (const Run &run : runs)
+        printf("%-18s %10d %12.3f %14.3f %12.3f %16.6e\n", run.ordering.c_str(), run.iterations, run.ordering_time,
+               run.linear_solver_time, run.total_time, run.final_cost);
 }
 
 
@@ -91,8 +72,16 @@ int main(int argc, char **argv) {
         cout << "Usage: ceres_bundle -input <path for dataset>";
         return 1;
     }
+    if (params.ordering == "compare") {
+        compareOrderings(params);
+        return 0;
+    }
+    if (find(begin(ORDERINGS), end(ORDERINGS), params.ordering) == end(ORDERINGS)) {
+        cerr << "unknown ordering " << params.ordering << endl;
+        return 1;
+    }
 
-    BALProblem bal_problem(params.input);
+    BALProblem bal_problem(params.input, false, !params.no_cache);
 
     // show some information here ...
     cout << "bal problem file loaded." << endl;
@@ -108,9 +97,7 @@ int main(int argc, char **argv) {
     cout << "beginning problem." << endl;
 
     // add some noise for the intial value
-    srand(static_cast<unsigned int>(params.random_seed));
-    bal_problem.Normalize();
-    bal_problem.Perturb(params.rotation_sigma, params.translation_sigma, params.point_sigma);
+    PerturbProblem(&bal_problem, params);
 
     cout << "normalization complete." << endl;
 
@@ -0,0 +1,89 @@
+#include "BALLayout.h"
+
+#include <vector>
+
+BALLayout::BALLayout(const BALProblem &problem)
+        : num_cameras_(problem.num_cameras()), num_points_(problem.num_points()),
+          num_observations_(problem.num_observations()) {
+    const int *camera_index = problem.camera_index();
+    const int *point_index = problem.point_index();
+
+    // counting sort by point, then a stable one by camera, linear in the number of observations
+    std::vector<int> by_point(num_observations_);
+    {
+        std::vector<int> fill(num_points_ + 1, 0);
+        for (int i = 0; i < num_observations_; ++i)
+            fill[point_index[i] + 1]++;
+        for (int j = 0; j < num_points_; ++j)
+            fill[j + 1] += fill[j];
+        for (int i = 0; i < num_observations_; ++i)
+            by_point[fill[point_index[i]]++] = i;
+    }
+    camera_offsets_.Resize(num_cameras_ + 1);
+    for (int i = 0; i < num_observations_; ++i)
+        camera_offsets_[camera_index[i] + 1]++;
+    for (int a = 0; a < num_cameras_; ++a)
+        camera_offsets_[a + 1] += camera_offsets_[a];
+    original_index_.Resize(num_observations_);
+    {
+        std::vector<int> fill(camera_offsets_.data(), camera_offsets_.data() + num_cameras_);
+        for (int k = 0; k < num_observations_; ++k) {
+            const int i = by_point[k];
+            original_index_[fill[camera_index[i]]++] = i;
+        }
+    }
+
+    camera_index_.Resize(num_observations_);
+    point_index_.Resize(num_observations_);
+    observed_x_.Resize(num_observations_);
+    observed_y_.Resize(num_observations_);
+    for (int k = 0; k < num_observations_; ++k) {
+        const int i = original_index_[k];
+        camera_index_[k] = camera_index[i];
+        point_index_[k] = point_index[i];
+        observed_x_[k] = problem.observations()[2 * i];
+        observed_y_[k] = problem.observations()[2 * i + 1];
+    }
+
+    // going through the sorted order lists the observations of every point by camera
+    point_offsets_.Resize(num_points_ + 1);
+    for (int k = 0; k < num_observations_; ++k)
+        point_offsets_[point_index_[k] + 1]++;
+    for (int j = 0; j < num_points_; ++j)
+        point_offsets_[j + 1] += point_offsets_[j];
+    point_observations_.Resize(num_observations_);
+    {
+        std::vector<int> fill(point_offsets_.data(), point_offsets_.data() + num_points_);
+        for (int k = 0; k < num_observations_; ++k)
+            point_observations_[fill[point_index_[k]]++] = k;
+    }
+
+    parameters_.Resize(num_parameters());
+    CopyParametersFrom(problem);
+}
+
+void BALLayout::Pack(const double *padded, double *packed) const {
+    for (int a = 0; a < num_cameras_; ++a)
+        for (int k = 0; k < CAMERA_SIZE; ++k)
+            packed[CAMERA_SIZE * a + k] = padded[camera_offset(a) + k];
+    packed += CAMERA_SIZE * num_cameras_;
+    for (int j = 0; j < num_points_; ++j)
+        for (int k = 0; k < POINT_SIZE; ++k)
+            packed[POINT_SIZE * j + k] = padded[point_offset(j) + k];
+}
+
+void BALLayout::Unpack(const double *packed, double *padded) const {
+    for (int a = 0; a < num_cameras_; ++a)
+        for (int k = 0; k < CAMERA_SIZE; ++k)
+            padded[camera_offset(a) + k] = packed[CAMERA_SIZE * a + k];
+    packed += CAMERA_SIZE * num_cameras_;
+    for (int j = 0; j < num_points_; ++j)
+        for (int k = 0; k < POINT_SIZE; ++k)
+            padded[point_offset(j) + k] = packed[POINT_SIZE * j + k];
+}
+
+size_t BALLayout::Bytes() const {
+    return (camera_index_.size() + point_index_.size() + original_index_.size() + camera_offsets_.size() +
+            point_offsets_.size() + point_observations_.size()) * sizeof(int) +
+           (observed_x_.size() + observed_y_.size() + parameters_.size()) * sizeof(double);
+}
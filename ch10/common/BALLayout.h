@@ -0,0 +1,148 @@
+#ifndef BALLAYOUT_H
+#define BALLAYOUT_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "BALProblem.h"
+
+// a heap array aligned to a cache line, the new[] of C++11 only guarantees the alignment of double
+template<typename T>
+class AlignedArray {
+public:
+    static const size_t ALIGNMENT = 64;
+
+    AlignedArray() : data_(NULL), size_(0) {}
+
+    explicit AlignedArray(size_t size) : data_(NULL), size_(0) { Resize(size); }
+
+    ~AlignedArray() { Free(); }
+
+    // the contents are zeroed, also when the size stays the same
+    void Resize(size_t size) {
+        if (size != size_) {
+            Free();
+            void *memory = NULL;
+            if (size > 0 && posix_memalign(&memory, ALIGNMENT, size * sizeof(T)) != 0)
+                throw std::bad_alloc();
+            data_ = static_cast<T *>(memory);
+            size_ = size;
+        }
+        if (size_ > 0)
+            memset(data_, 0, size_ * sizeof(T));
+    }
+
+    size_t size() const { return size_; }
+
+    T *data() { return data_; }
+
+    const T *data() const { return data_; }
+
+    T &operator[](size_t i) { return data_[i]; }
+
+    const T &operator[](size_t i) const { return data_[i]; }
+
+private:
+    AlignedArray(const AlignedArray &);
+
+    AlignedArray &operator=(const AlignedArray &);
+
+    void Free() {
+        free(data_);
+        data_ = NULL;
+        size_ = 0;
+    }
+
+    T *data_;
+    size_t size_;
+};
+
+// A copy of a BALProblem laid out for passes that stream through memory instead of gathering:
+// - the observations are sorted by camera and, within a camera, by point, so the observations of camera a
+//   are the contiguous range [camera_offsets()[a], camera_offsets()[a + 1]) and its points are visited in
+//   increasing address order
+// - every field of the observations is an array of its own (structure of arrays)
+// - every camera starts on a cache line and is padded from 9 to CAMERA_STRIDE doubles, every point from 3 to
+//   POINT_STRIDE doubles, with the padding kept at zero so that whole blocks can be loaded into SIMD registers
+// - the observations of each point are listed CSR style by their position in the sorted order
+// Only angle-axis cameras are supported, i.e. a BALProblem loaded with use_quaternions = false.
+class BALLayout {
+public:
+    static const int CAMERA_SIZE = 9;
+    static const int POINT_SIZE = 3;
+    static const int CAMERA_STRIDE = 16;
+    static const int POINT_STRIDE = 4;
+
+    explicit BALLayout(const BALProblem &problem);
+
+    int num_cameras() const { return num_cameras_; }
+
+    int num_points() const { return num_points_; }
+
+    int num_observations() const { return num_observations_; }
+
+    // per observation in the sorted order
+    const int *camera_index() const { return camera_index_.data(); }
+
+    const int *point_index() const { return point_index_.data(); }
+
+    const double *observed_x() const { return observed_x_.data(); }
+
+    const double *observed_y() const { return observed_y_.data(); }
+
+    // where the observation was in the BALProblem
+    const int *original_index() const { return original_index_.data(); }
+
+    // num_cameras + 1 entries
+    const int *camera_offsets() const { return camera_offsets_.data(); }
+
+    // num_points + 1 entries, point_observations lists the positions of the observations of every point
+    const int *point_offsets() const { return point_offsets_.data(); }
+
+    const int *point_observations() const { return point_observations_.data(); }
+
+    // the padded parameters, the cameras followed by the points
+    int num_parameters() const { return CAMERA_STRIDE * num_cameras_ + POINT_STRIDE * num_points_; }
+
+    int camera_offset(int camera) const { return CAMERA_STRIDE * camera; }
+
+    int point_offset(int point) const { return CAMERA_STRIDE * num_cameras_ + POINT_STRIDE * point; }
+
+    const double *parameters() const { return parameters_.data(); }
+
+    double *mutable_parameters() { return parameters_.data(); }
+
+    const double *camera(int camera) const { return parameters_.data() + camera_offset(camera); }
+
+    const double *point(int point) const { return parameters_.data() + point_offset(point); }
+
+    // between the padded parameters and the packed ones of a BALProblem, packed being 9 doubles per camera
+    // followed by 3 per point
+    void Pack(const double *padded, double *packed) const;
+
+    void Unpack(const double *packed, double *padded) const;
+
+    void CopyParametersFrom(const BALProblem &problem) { Unpack(problem.parameters(), parameters_.data()); }
+
+    void CopyParametersTo(BALProblem *problem) const { Pack(parameters_.data(), problem->mutable_cameras()); }
+
+    size_t Bytes() const;
+
+private:
+    int num_cameras_;
+    int num_points_;
+    int num_observations_;
+
+    AlignedArray<int> camera_index_;
+    AlignedArray<int> point_index_;
+    AlignedArray<double> observed_x_;
+    AlignedArray<double> observed_y_;
+    AlignedArray<int> original_index_;
+    AlignedArray<int> camera_offsets_;
+    AlignedArray<int> point_offsets_;
+    AlignedArray<int> point_observations_;
+    AlignedArray<double> parameters_;
+};
+
+#endif // BALLayout.h
@@ -2,6 +2,15 @@
 
 #include <fstream>
 #include <vector>
+#include <thread>
+#include <chrono>
+#include <limits>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <Eigen/Core>
 #include "tools/random.h"
 #include "tools/rotation.h"
@@ -9,13 +18,6 @@
 typedef Eigen::Map<Eigen::VectorXd> VectorRef;
 typedef Eigen::Map<const Eigen::VectorXd> ConstVectorRef;
 
-template<typename T>
-void FscanfOrDie(FILE *fptr, const char *format, T *value) {
-    int num_scanned = fscanf(fptr, format, value);
-    if (num_scanned != 1)
-        std::cerr << "Invalid UW data file. ";
-}
-
 void PerturbPoint3(const double sigma, double *point) {
     for (int i = 0; i < 3; ++i)
         point[i] += RandNormal() * sigma;
@@ -29,46 +31,208 @@ double Median(std::vector<double> *data) {
 }
 
 
-BALProblem::BALProblem(const std::string &filename, bool use_quaternions) {
-    FILE *fptr = fopen(filename.c_str(), "r");
+namespace {
+// read-only mapping of a whole file, empty if it cannot be mapped
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &filename) : data_(NULL), size_(0) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, st.st_size, MADV_SEQUENTIAL);
+                data_ = static_cast<const char *>(data);
+                size_ = st.st_size;
+            }
+        }
+        close(fd);
+    }
 
+    ~MappedFile() {
+        if (data_ != NULL)
+            munmap(const_cast<char *>(data_), size_);
+    }
 
-    if (fptr == NULL) {
-        std::cerr << "Error: unable to open file " << filename;
-        return;
-    };
+    const char *data() const { return data_; }
 
-    // This wil die horribly on invalid files. Them's the breaks.
-    FscanfOrDie(fptr, "%d", &num_cameras_);
-    FscanfOrDie(fptr, "%d", &num_points_);
-    FscanfOrDie(fptr, "%d", &num_observations_);
+    size_t size() const { return size_; }
 
-    std::cout << "Header: " << num_cameras_
-              << " " << num_points_
-              << " " << num_observations_ << "\n";
+private:
+    MappedFile(const MappedFile &);
 
-    point_index_ = new int[num_observations_];
-    camera_index_ = new int[num_observations_];
-    observations_ = new double[2 * num_observations_];
+    MappedFile &operator=(const MappedFile &);
 
-    num_parameters_ = 9 * num_cameras_ + 3 * num_points_;
-    parameters_ = new double[num_parameters_];
+    const char *data_;
+    size_t size_;
+};
 
-    for (int i = 0; i < num_observations_; ++i) {
-        FscanfOrDie(fptr, "%d", camera_index_ + i);
-        FscanfOrDie(fptr, "%d", point_index_ + i);
-        for (int j = 0; j < 2; ++j) {
-            FscanfOrDie(fptr, "%lf", observations_ + 2 * i + j);
+inline bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+inline const char *SkipSpace(const char *p, const char *end) {
+    while (p < end && IsSpace(*p))
+        ++p;
+    return p;
+}
+
+inline const char *TokenEnd(const char *p, const char *end) {
+    while (p < end && !IsSpace(*p))
+        ++p;
+    return p;
+}
+
+bool ParseInt(const char *p, const char *end, int *value) {
+    bool negative = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+'))
+        ++p;
+    if (p == end)
+        return false;
+    // checked after every digit, INT_MIN has one more than INT_MAX
+    const long long limit = static_cast<long long>(std::numeric_limits<int>::max()) + (negative ? 1 : 0);
+    long long v = 0;
+    for (; p < end; ++p) {
+        if (*p < '0' || *p > '9')
+            return false;
+        v = 10 * v + (*p - '0');
+        if (v > limit)
+            return false;
+    }
+    *value = static_cast<int>(negative ? -v : v);
+    return true;
+}
+
+// exact for up to 15 significant digits and a power of ten up to 22, where both the mantissa and the power
+// are exact doubles and one multiplication or division rounds correctly. everything else goes to strtod
+bool ParseDouble(const char *p, const char *end, double *value) {
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *token = p;
+    bool negative = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+'))
+        ++p;
+    unsigned long long mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any_digit = false;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, any_digit = true) {
+        if (mantissa == 0 && *p == '0')
+            continue;
+        if (digits < 19) {
+            mantissa = 10 * mantissa + (*p - '0');
+            digits++;
+        } else {
+            exponent++;
         }
     }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, any_digit = true) {
+            if (mantissa == 0 && *p == '0') {
+                exponent--;
+                continue;
+            }
+            if (digits < 19) {
+                mantissa = 10 * mantissa + (*p - '0');
+                digits++;
+                exponent--;
+            }
+        }
+    }
+    if (any_digit && p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negative_exponent = (p < end && *p == '-');
+        if (p < end && (*p == '-' || *p == '+'))
+            ++p;
+        int e = 0;
+        bool any_exponent_digit = false;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p, any_exponent_digit = true)
+            e = std::min(10 * e + (*p - '0'), 100000);
+        if (!any_exponent_digit)
+            any_digit = false;
+        exponent += negative_exponent ? -e : e;
+    }
 
-    for (int i = 0; i < num_parameters_; ++i) {
-        FscanfOrDie(fptr, "%lf", parameters_ + i);
+    if (any_digit && p == end && digits <= 15 && exponent >= -22 && exponent <= 22) {
+        double v = static_cast<double>(mantissa);
+        v = exponent < 0 ? v / powers[-exponent] : v * powers[exponent];
+        *value = negative ? -v : v;
+        return true;
     }
 
-    fclose(fptr);
+    // long mantissas, large exponents, inf and nan
+    char buffer[128];
+    size_t length = end - token;
+    if (length >= sizeof(buffer))
+        return false;
+    memcpy(buffer, token, length);
+    buffer[length] = '\0';
+    char *parsed;
+    *value = strtod(buffer, &parsed);
+    return parsed == buffer + length;
+}
+
+// [begin, end) of a chunk of the file, cut at whitespace so no number is split
+struct Chunk {
+    const char *begin, *end;
+    long long first_token;
+    long long num_tokens;
+    bool ok;
+};
+
+const char CACHE_MAGIC[8] = {'B', 'A', 'L', 'C', 'A', 'C', 'H', 'E'};
+const int32_t CACHE_VERSION = 2;
+
+// followed by camera_index, point_index, observations and the angle-axis parameters, in native byte order
+struct CacheHeader {
+    char magic[8];
+    int32_t version;
+    int32_t num_cameras;
+    int32_t num_points;
+    int32_t num_observations;
+    // the text file the cache was made from
+    int64_t source_size;
+    int64_t source_mtime_ns;
+};
+
+// whole seconds would miss a file rewritten within the same second as the cache
+int64_t ModificationTimeNs(const struct stat &st) {
+#ifdef __APPLE__
+    return int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+size_t CacheSize(const CacheHeader &header) {
+    size_t num_observations = header.num_observations;
+    size_t num_parameters = 9 * size_t(header.num_cameras) + 3 * size_t(header.num_points);
+    return sizeof(CacheHeader) + 2 * num_observations * sizeof(int32_t) +
+           (2 * num_observations + num_parameters) * sizeof(double);
+}
+}
+
+BALProblem::BALProblem(const std::string &filename, bool use_quaternions, bool use_cache)
+        : num_cameras_(0), num_points_(0), num_observations_(0), num_parameters_(0),
+          use_quaternions_(use_quaternions), point_index_(NULL), camera_index_(NULL), observations_(NULL),
+          parameters_(NULL) {
+    const std::string cache_file = filename + ".cache";
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool from_cache = use_cache && ReadCache(cache_file, filename);
+    if (!from_cache) {
+        if (!ReadText(filename))
+            return;
+        if (use_cache)
+            WriteCache(cache_file, filename);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Header: " << num_cameras_
+              << " " << num_points_
+              << " " << num_observations_ << "\n";
+    std::cout << "loaded " << (from_cache ? cache_file : filename) << " in " << seconds << " s\n";
 
-    use_quaternions_ = use_quaternions;
     if (use_quaternions) {
         // Switch the angle-axis rotations to quaternions.
         num_parameters_ = 10 * num_cameras_ + 3 * num_points_;
@@ -94,6 +258,199 @@ BALProblem::BALProblem(const std::string &filename, bool use_quaternions) {
 }
 
 
+void BALProblem::Allocate() {
+    num_parameters_ = 9 * num_cameras_ + 3 * num_points_;
+    point_index_ = new int[num_observations_];
+    camera_index_ = new int[num_observations_];
+    observations_ = new double[2 * num_observations_];
+    parameters_ = new double[num_parameters_];
+}
+
+void BALProblem::Release() {
+    delete[] point_index_;
+    delete[] camera_index_;
+    delete[] observations_;
+    delete[] parameters_;
+    point_index_ = camera_index_ = NULL;
+    observations_ = parameters_ = NULL;
+    num_cameras_ = num_points_ = num_observations_ = num_parameters_ = 0;
+}
+
+bool BALProblem::ReadText(const std::string &filename) {
+    MappedFile file(filename);
+    if (file.data() == NULL) {
+        std::cerr << "Error: unable to open file " << filename;
+        return false;
+    }
+    const char *p = file.data();
+    const char *end = file.data() + file.size();
+
+    int header[3];
+    for (int i = 0; i < 3; ++i) {
+        p = SkipSpace(p, end);
+        const char *token_end = TokenEnd(p, end);
+        if (!ParseInt(p, token_end, header + i) || header[i] < 0) {
+            std::cerr << "Invalid UW data file. ";
+            return false;
+        }
+        p = token_end;
+    }
+    num_cameras_ = header[0];
+    num_points_ = header[1];
+    num_observations_ = header[2];
+    Allocate();
+
+    // cut the body into chunks at whitespace, count the numbers in each and then parse them all in parallel,
+    // the count of the preceding chunks tells where the numbers of a chunk go
+    const size_t min_chunk_size = 1 << 20;
+    size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t num_chunks = std::max<size_t>(1, std::min<size_t>(num_threads, (end - p) / min_chunk_size));
+    std::vector<Chunk> chunks(num_chunks);
+    for (size_t k = 0; k < num_chunks; ++k) {
+        chunks[k].begin = k == 0 ? p : chunks[k - 1].end;
+        chunks[k].end = k + 1 == num_chunks ? end : TokenEnd(p + (end - p) * (k + 1) / num_chunks, end);
+        chunks[k].end = std::max(chunks[k].begin, chunks[k].end);
+        chunks[k].ok = true;
+    }
+    std::vector<std::thread> workers;
+    for (size_t k = 0; k < num_chunks; ++k) {
+        workers.push_back(std::thread([&chunks, k] {
+            long long count = 0;
+            const char *q = SkipSpace(chunks[k].begin, chunks[k].end);
+            while (q < chunks[k].end) {
+                q = SkipSpace(TokenEnd(q, chunks[k].end), chunks[k].end);
+                count++;
+            }
+            chunks[k].num_tokens = count;
+        }));
+    }
+    for (size_t k = 0; k < workers.size(); ++k)
+        workers[k].join();
+
+    long long num_tokens = 0;
+    for (size_t k = 0; k < num_chunks; ++k) {
+        chunks[k].first_token = num_tokens;
+        num_tokens += chunks[k].num_tokens;
+    }
+    const long long num_observation_tokens = 4LL * num_observations_;
+    if (num_tokens < num_observation_tokens + num_parameters_) {
+        std::cerr << "Invalid UW data file. ";
+        Release();
+        return false;
+    }
+
+    // each line of the observations is "camera point x y", the parameters follow one number at a time
+    workers.clear();
+    for (size_t k = 0; k < num_chunks; ++k) {
+        workers.push_back(std::thread([this, &chunks, k, num_observation_tokens] {
+            Chunk &chunk = chunks[k];
+            long long t = chunk.first_token;
+            const char *q = SkipSpace(chunk.begin, chunk.end);
+            while (q < chunk.end && t < num_observation_tokens + num_parameters_) {
+                const char *token_end = TokenEnd(q, chunk.end);
+                bool ok;
+                if (t < num_observation_tokens) {
+                    long long i = t / 4;
+                    switch (t % 4) {
+                        case 0:
+                            ok = ParseInt(q, token_end, camera_index_ + i);
+                            break;
+                        case 1:
+                            ok = ParseInt(q, token_end, point_index_ + i);
+                            break;
+                        default:
+                            ok = ParseDouble(q, token_end, observations_ + 2 * i + t % 4 - 2);
+                    }
+                } else {
+                    ok = ParseDouble(q, token_end, parameters_ + (t - num_observation_tokens));
+                }
+                chunk.ok = chunk.ok && ok;
+                q = SkipSpace(token_end, chunk.end);
+                t++;
+            }
+        }));
+    }
+    for (size_t k = 0; k < workers.size(); ++k)
+        workers[k].join();
+
+    // a partial parse leaves slots unset, it must not go on to the solver or into the cache
+    bool ok = true;
+    for (size_t k = 0; k < num_chunks; ++k)
+        ok = ok && chunks[k].ok;
+    for (int i = 0; ok && i < num_observations_; ++i)
+        ok = camera_index_[i] >= 0 && camera_index_[i] < num_cameras_ && point_index_[i] >= 0 &&
+             point_index_[i] < num_points_;
+    if (!ok) {
+        std::cerr << "Invalid UW data file. ";
+        Release();
+        return false;
+    }
+    return true;
+}
+
+bool BALProblem::ReadCache(const std::string &cache_file, const std::string &filename) {
+    struct stat source;
+    if (stat(filename.c_str(), &source) != 0)
+        return false;
+    MappedFile file(cache_file);
+    if (file.data() == NULL || file.size() < sizeof(CacheHeader))
+        return false;
+    CacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.num_cameras < 0 || header.num_points < 0 || header.num_observations < 0 ||
+        header.source_size != int64_t(source.st_size) || header.source_mtime_ns != ModificationTimeNs(source) ||
+        file.size() != CacheSize(header))
+        return false;
+
+    num_cameras_ = header.num_cameras;
+    num_points_ = header.num_points;
+    num_observations_ = header.num_observations;
+    Allocate();
+    const char *p = file.data() + sizeof(header);
+    memcpy(camera_index_, p, num_observations_ * sizeof(int));
+    p += num_observations_ * sizeof(int32_t);
+    memcpy(point_index_, p, num_observations_ * sizeof(int));
+    p += num_observations_ * sizeof(int32_t);
+    memcpy(observations_, p, 2 * num_observations_ * sizeof(double));
+    p += 2 * num_observations_ * sizeof(double);
+    memcpy(parameters_, p, num_parameters_ * sizeof(double));
+    return true;
+}
+
+void BALProblem::WriteCache(const std::string &cache_file, const std::string &filename) const {
+    struct stat source;
+    if (stat(filename.c_str(), &source) != 0)
+        return;
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.num_cameras = num_cameras_;
+    header.num_points = num_points_;
+    header.num_observations = num_observations_;
+    header.source_size = source.st_size;
+    header.source_mtime_ns = ModificationTimeNs(source);
+
+    // written aside and renamed, so a concurrent or interrupted run never sees half a cache
+    const std::string tmp_file = cache_file + ".tmp";
+    FILE *fptr = fopen(tmp_file.c_str(), "wb");
+    if (fptr == NULL) {
+        std::cerr << "Warning: unable to write the cache " << cache_file << "\n";
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fptr) == 1 &&
+              fwrite(camera_index_, sizeof(int), num_observations_, fptr) == size_t(num_observations_) &&
+              fwrite(point_index_, sizeof(int), num_observations_, fptr) == size_t(num_observations_) &&
+              fwrite(observations_, sizeof(double), 2 * num_observations_, fptr) == size_t(2 * num_observations_) &&
+              fwrite(parameters_, sizeof(double), num_parameters_, fptr) == size_t(num_parameters_);
+    ok = (fclose(fptr) == 0) && ok;
+    if (!ok || rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+        std::cerr << "Warning: unable to write the cache " << cache_file << "\n";
+        remove(tmp_file.c_str());
+    }
+}
+
 void BALProblem::WriteToFile(const std::string &filename) const {
     FILE *fptr = fopen(filename.c_str(), "w");
 
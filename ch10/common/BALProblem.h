@@ -8,7 +8,9 @@
 
 class BALProblem {
 public:
-    explicit BALProblem(const std::string &filename, bool use_quaternions = false);
+    // the text file is parsed once, later loads read the binary copy <filename>.cache written next to it,
+    // which is rebuilt whenever the text file changes. use_cache = false neither reads nor writes it
+    explicit BALProblem(const std::string &filename, bool use_quaternions = false, bool use_cache = true);
 
     ~BALProblem() {
         delete[] point_index_;
@@ -74,6 +76,19 @@ public:
 
 
 private:
+    void Allocate();
+
+    // back to an empty problem after a failed parse
+    void Release();
+
+    // parse the text file, in parallel over chunks of the memory mapped file. false, with an empty problem, if any
+    // number fails to parse or an index is out of range
+    bool ReadText(const std::string &filename);
+
+    bool ReadCache(const std::string &cache_file, const std::string &filename);
+
+    void WriteCache(const std::string &cache_file, const std::string &filename) const;
+
     void CameraToAngelAxisAndCenter(const double *camera,
                                     double *angle_axis,
                                     double *center) const;
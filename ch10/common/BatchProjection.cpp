@@ -0,0 +1,96 @@
+#include "BatchProjection.h"
+
+#include "BatchProjectionKernel.h"
+#include "projection.h"
+
+namespace {
+// one observation at a time, for CPUs and compilers without the vector kernels
+struct ScalarPacket {
+    static const int SIZE = 1;
+
+    ScalarPacket() {}
+
+    explicit ScalarPacket(double value) : v(value) {}
+
+    static ScalarPacket Load(const double *values) { return ScalarPacket(values[0]); }
+
+    static ScalarPacket Gather(const double *base, const int *index) { return ScalarPacket(base[4 * index[0]]); }
+
+    void Store(double *values) const { values[0] = v; }
+
+    double v;
+};
+
+inline ScalarPacket operator+(const ScalarPacket &a, const ScalarPacket &b) { return ScalarPacket(a.v + b.v); }
+
+inline ScalarPacket operator-(const ScalarPacket &a, const ScalarPacket &b) { return ScalarPacket(a.v - b.v); }
+
+inline ScalarPacket operator*(const ScalarPacket &a, const ScalarPacket &b) { return ScalarPacket(a.v * b.v); }
+
+inline ScalarPacket operator/(const ScalarPacket &a, const ScalarPacket &b) { return ScalarPacket(a.v / b.v); }
+
+inline ScalarPacket operator-(const ScalarPacket &a) { return ScalarPacket(-a.v); }
+}
+
+bool BatchProjectionKernelAvailable(BatchProjectionKernel kernel) {
+    switch (kernel) {
+        case SCALAR_KERNEL:
+            return true;
+#if defined(BATCH_PROJECTION_AVX2)
+        case AVX2_KERNEL:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#if defined(BATCH_PROJECTION_AVX512)
+        case AVX512_KERNEL:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+BatchProjectionKernel BestBatchProjectionKernel() {
+    static const BatchProjectionKernel best = BatchProjectionKernelAvailable(AVX512_KERNEL) ? AVX512_KERNEL :
+                                              BatchProjectionKernelAvailable(AVX2_KERNEL) ? AVX2_KERNEL :
+                                              SCALAR_KERNEL;
+    return best;
+}
+
+const char *BatchProjectionKernelName(BatchProjectionKernel kernel) {
+    switch (kernel) {
+        case AVX2_KERNEL:
+            return "avx2";
+        case AVX512_KERNEL:
+            return "avx512";
+        default:
+            return "scalar";
+    }
+}
+
+void CameraRotation(const double *camera, double *rotation) {
+    AngleAxisToRotationAndJacobian(camera, rotation, rotation + 9);
+}
+
+void ProjectCameraObservations(BatchProjectionKernel kernel, const double *camera, const double *rotation,
+                               const double *points, const int *point_index, const double *observed_x,
+                               const double *observed_y, int n, double *residuals, double *jacobian_camera,
+                               double *jacobian_point) {
+    switch (kernel) {
+#if defined(BATCH_PROJECTION_AVX2)
+        case AVX2_KERNEL:
+            ProjectCameraObservationsAVX2(camera, rotation, points, point_index, observed_x, observed_y, n,
+                                          residuals, jacobian_camera, jacobian_point);
+            return;
+#endif
+#if defined(BATCH_PROJECTION_AVX512)
+        case AVX512_KERNEL:
+            ProjectCameraObservationsAVX512(camera, rotation, points, point_index, observed_x, observed_y, n,
+                                            residuals, jacobian_camera, jacobian_point);
+            return;
+#endif
+        default:
+            ProjectCameraObservationsKernel<ScalarPacket>(camera, rotation, points, point_index, observed_x,
+                                                          observed_y, n, residuals, jacobian_camera,
+                                                          jacobian_point);
+    }
+}
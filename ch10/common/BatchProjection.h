@@ -0,0 +1,37 @@
+#ifndef BATCHPROJECTION_H
+#define BATCHPROJECTION_H
+
+// CamProjectionWithDistortionJacobian for many observations of one camera at once. Everything that only
+// depends on the camera, the rotation matrix and the left Jacobian of the angle-axis with their sines and
+// cosines, is computed once by CameraRotation, what is left per observation is a few dozen multiply-adds
+// evaluated for 4 (AVX2) or 8 (AVX-512) observations at a time. The kernel is picked at runtime from what the
+// CPU supports, SCALAR_KERNEL runs the same code one observation at a time.
+
+enum BatchProjectionKernel {
+    SCALAR_KERNEL,
+    AVX2_KERNEL,
+    AVX512_KERNEL
+};
+
+// compiled in and supported by this CPU
+bool BatchProjectionKernelAvailable(BatchProjectionKernel kernel);
+
+// the widest available kernel
+BatchProjectionKernel BestBatchProjectionKernel();
+
+const char *BatchProjectionKernelName(BatchProjectionKernel kernel);
+
+// rotation : 18 doubles, the row-major rotation matrix of the camera followed by its left Jacobian
+void CameraRotation(const double *camera, double *rotation);
+
+// the observations 0 .. n-1 of a camera, as laid out by BALLayout
+// points : point j starts at points + 4 * j
+// point_index, observed_x, observed_y : n entries each
+// residuals : 2 per observation, the prediction minus the observation
+// jacobian_camera, jacobian_point : 2x9 and 2x3 row-major per observation, both NULL or both set
+void ProjectCameraObservations(BatchProjectionKernel kernel, const double *camera, const double *rotation,
+                               const double *points, const int *point_index, const double *observed_x,
+                               const double *observed_y, int n, double *residuals, double *jacobian_camera,
+                               double *jacobian_point);
+
+#endif // BatchProjection.h
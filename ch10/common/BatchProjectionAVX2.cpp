@@ -0,0 +1,43 @@
+// compiled with -mavx2 -mfma, only called when the CPU supports both
+#include <immintrin.h>
+#include "BatchProjectionKernel.h"
+
+namespace {
+struct Packet {
+    static const int SIZE = 4;
+
+    Packet() {}
+
+    explicit Packet(double value) : v(_mm256_set1_pd(value)) {}
+
+    explicit Packet(__m256d value) : v(value) {}
+
+    static Packet Load(const double *values) { return Packet(_mm256_loadu_pd(values)); }
+
+    static Packet Gather(const double *base, const int *index) {
+        const __m128i offsets = _mm_slli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(index)), 2);
+        return Packet(_mm256_i32gather_pd(base, offsets, 8));
+    }
+
+    void Store(double *values) const { _mm256_storeu_pd(values, v); }
+
+    __m256d v;
+};
+
+inline Packet operator+(const Packet &a, const Packet &b) { return Packet(_mm256_add_pd(a.v, b.v)); }
+
+inline Packet operator-(const Packet &a, const Packet &b) { return Packet(_mm256_sub_pd(a.v, b.v)); }
+
+inline Packet operator*(const Packet &a, const Packet &b) { return Packet(_mm256_mul_pd(a.v, b.v)); }
+
+inline Packet operator/(const Packet &a, const Packet &b) { return Packet(_mm256_div_pd(a.v, b.v)); }
+
+inline Packet operator-(const Packet &a) { return Packet(_mm256_xor_pd(a.v, _mm256_set1_pd(-0.0))); }
+}
+
+void ProjectCameraObservationsAVX2(const double *camera, const double *rotation, const double *points,
+                                   const int *point_index, const double *observed_x, const double *observed_y,
+                                   int n, double *residuals, double *jacobian_camera, double *jacobian_point) {
+    ProjectCameraObservationsKernel<Packet>(camera, rotation, points, point_index, observed_x, observed_y, n,
+                                            residuals, jacobian_camera, jacobian_point);
+}
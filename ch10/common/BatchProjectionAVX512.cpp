@@ -0,0 +1,43 @@
+// compiled with -mavx512f, only called when the CPU supports it
+#include <immintrin.h>
+#include "BatchProjectionKernel.h"
+
+namespace {
+struct Packet {
+    static const int SIZE = 8;
+
+    Packet() {}
+
+    explicit Packet(double value) : v(_mm512_set1_pd(value)) {}
+
+    explicit Packet(__m512d value) : v(value) {}
+
+    static Packet Load(const double *values) { return Packet(_mm512_loadu_pd(values)); }
+
+    static Packet Gather(const double *base, const int *index) {
+        const __m256i offsets = _mm256_slli_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(index)), 2);
+        return Packet(_mm512_i32gather_pd(offsets, base, 8));
+    }
+
+    void Store(double *values) const { _mm512_storeu_pd(values, v); }
+
+    __m512d v;
+};
+
+inline Packet operator+(const Packet &a, const Packet &b) { return Packet(_mm512_add_pd(a.v, b.v)); }
+
+inline Packet operator-(const Packet &a, const Packet &b) { return Packet(_mm512_sub_pd(a.v, b.v)); }
+
+inline Packet operator*(const Packet &a, const Packet &b) { return Packet(_mm512_mul_pd(a.v, b.v)); }
+
+inline Packet operator/(const Packet &a, const Packet &b) { return Packet(_mm512_div_pd(a.v, b.v)); }
+
+inline Packet operator-(const Packet &a) { return Packet(_mm512_sub_pd(_mm512_setzero_pd(), a.v)); }
+}
+
+void ProjectCameraObservationsAVX512(const double *camera, const double *rotation, const double *points,
+                                     const int *point_index, const double *observed_x, const double *observed_y,
+                                     int n, double *residuals, double *jacobian_camera, double *jacobian_point) {
+    ProjectCameraObservationsKernel<Packet>(camera, rotation, points, point_index, observed_x, observed_y, n,
+                                            residuals, jacobian_camera, jacobian_point);
+}
@@ -0,0 +1,132 @@
+#ifndef BATCHPROJECTIONKERNEL_H
+#define BATCHPROJECTIONKERNEL_H
+
+// The kernel behind ProjectCameraObservations, written once for a packet type P of P::SIZE doubles that has
+// the arithmetic operators, a broadcasting constructor, and
+//   static P Load(const double *values);
+//   static P Gather(const double *base, const int *index);  // base[4 * index[k]] in lane k
+//   void Store(double *values) const;
+// It is included by the translation units compiled for each instruction set, so it must not include anything
+// whose inline functions could then be shared with code compiled without those instructions.
+
+#include <cstddef>
+
+// the entry points of the instruction set specific translation units, see BatchProjection.h
+void ProjectCameraObservationsAVX2(const double *camera, const double *rotation, const double *points,
+                                   const int *point_index, const double *observed_x, const double *observed_y,
+                                   int n, double *residuals, double *jacobian_camera, double *jacobian_point);
+
+void ProjectCameraObservationsAVX512(const double *camera, const double *rotation, const double *points,
+                                     const int *point_index, const double *observed_x, const double *observed_y,
+                                     int n, double *residuals, double *jacobian_camera, double *jacobian_point);
+
+template<typename P>
+inline void ProjectCameraObservationsKernel(const double *camera, const double *rotation, const double *points,
+                                            const int *point_index, const double *observed_x,
+                                            const double *observed_y, int n, double *residuals,
+                                            double *jacobian_camera, double *jacobian_point) {
+    const int SIZE = P::SIZE;
+    // the camera is the same in all lanes
+    P R[9], Jl[9];
+    for (int k = 0; k < 9; ++k) {
+        R[k] = P(rotation[k]);
+        Jl[k] = P(rotation[9 + k]);
+    }
+    const P t0(camera[3]), t1(camera[4]), t2(camera[5]);
+    const P focal(camera[6]), l1(camera[7]), l2(camera[8]);
+    const P one(1.0), two(2.0);
+    const bool jacobians = jacobian_camera != NULL;
+
+    // per lane: 2 residuals, then the 2x9 camera and 2x3 point Jacobians row-major
+    double out[26][SIZE];
+    // the last partial batch, its lanes past the end repeat the first observation and are not written back
+    int tail_index[SIZE];
+    double tail_x[SIZE], tail_y[SIZE];
+    for (int i = 0; i < n; i += SIZE) {
+        const int lanes = n - i < SIZE ? n - i : SIZE;
+        const int *index = point_index + i;
+        const double *ox = observed_x + i, *oy = observed_y + i;
+        if (lanes < SIZE) {
+            for (int k = 0; k < SIZE; ++k) {
+                const int o = k < lanes ? k : 0;
+                tail_index[k] = index[o];
+                tail_x[k] = ox[o];
+                tail_y[k] = oy[o];
+            }
+            index = tail_index;
+            ox = tail_x;
+            oy = tail_y;
+        }
+        const P x = P::Gather(points, index), y = P::Gather(points + 1, index), z = P::Gather(points + 2, index);
+
+        // q = R * point, p = q + t
+        const P q0 = R[0] * x + R[1] * y + R[2] * z;
+        const P q1 = R[3] * x + R[4] * y + R[5] * z;
+        const P q2 = R[6] * x + R[7] * y + R[8] * z;
+        const P p0 = q0 + t0, p1 = q1 + t1, p2 = q2 + t2;
+
+        const P inv_z = one / p2;
+        const P xp = -(p0 * inv_z);
+        const P yp = -(p1 * inv_z);
+        const P r2 = xp * xp + yp * yp;
+        const P distortion = one + r2 * (l1 + l2 * r2);
+        const P fd = focal * distortion;
+        (fd * xp - P::Load(ox)).Store(out[0]);
+        (fd * yp - P::Load(oy)).Store(out[1]);
+
+        if (jacobians) {
+            // d(predictions)/d(xp, yp)
+            const P dd_dr2 = l1 + two * l2 * r2;
+            const P a00 = focal * (distortion + two * xp * xp * dd_dr2);
+            const P a01 = focal * two * xp * yp * dd_dr2;
+            const P a11 = focal * (distortion + two * yp * yp * dd_dr2);
+
+            // d(predictions)/dp
+            const P xz = -(xp * inv_z), yz = -(yp * inv_z);
+            const P dp[2][3] = {{-(a00 * inv_z), -(a01 * inv_z), a00 * xz + a01 * yz},
+                                {-(a01 * inv_z), -(a11 * inv_z), a01 * xz + a11 * yz}};
+
+            // dp/dw = -hat(q) * Jl
+            P dp_dw[9];
+            for (int c = 0; c < 3; ++c) {
+                dp_dw[c] = q2 * Jl[3 + c] - q1 * Jl[6 + c];
+                dp_dw[3 + c] = q0 * Jl[6 + c] - q2 * Jl[c];
+                dp_dw[6 + c] = q1 * Jl[c] - q0 * Jl[3 + c];
+            }
+
+            const P xy[2] = {xp, yp};
+            for (int r = 0; r < 2; ++r) {
+                double (*row)[SIZE] = out + 2 + 9 * r;
+                for (int c = 0; c < 3; ++c)
+                    (dp[r][0] * dp_dw[c] + dp[r][1] * dp_dw[3 + c] + dp[r][2] * dp_dw[6 + c]).Store(row[c]);
+                dp[r][0].Store(row[3]);
+                dp[r][1].Store(row[4]);
+                dp[r][2].Store(row[5]);
+                (distortion * xy[r]).Store(row[6]);
+                const P fxr2 = focal * xy[r] * r2;
+                fxr2.Store(row[7]);
+                (fxr2 * r2).Store(row[8]);
+                // dp/d(point) = R
+                for (int c = 0; c < 3; ++c)
+                    (dp[r][0] * R[c] + dp[r][1] * R[3 + c] + dp[r][2] * R[6 + c]).Store(out[20 + 3 * r + c]);
+            }
+        }
+
+        for (int k = 0; k < lanes; ++k) {
+            residuals[2 * (i + k)] = out[0][k];
+            residuals[2 * (i + k) + 1] = out[1][k];
+        }
+        if (jacobians) {
+            for (int k = 0; k < lanes; ++k) {
+                double *jc = jacobian_camera + 18 * (i + k);
+                double *jp = jacobian_point + 6 * (i + k);
+                for (int e = 0; e < 18; ++e)
+                    jc[e] = out[2 + e][k];
+                for (int e = 0; e < 6; ++e)
+                    jp[e] = out[20 + e][k];
+            }
+        }
+    }
+}
+
+#endif // BatchProjectionKernel.h
@@ -0,0 +1,804 @@
+#include "BundleAdjuster.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <Eigen/LU>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include "BatchProjection.h"
+
+typedef Eigen::Matrix<double, 2, 9, Eigen::RowMajor> Mat29;
+typedef Eigen::Matrix<double, 2, 3, Eigen::RowMajor> Mat23;
+typedef Eigen::Matrix<double, 9, 9, Eigen::RowMajor> Mat99;
+typedef Eigen::Matrix<double, 9, 3, Eigen::RowMajor> Mat93;
+typedef Eigen::Matrix<double, 3, 3, Eigen::RowMajor> Mat33;
+typedef Eigen::Matrix<double, 9, 1> Vec9;
+typedef Eigen::Matrix<double, 3, 1> Vec3;
+typedef Eigen::Matrix<double, 2, 1> Vec2;
+
+namespace {
+const int CAMERA_SIZE = 9;
+const int POINT_SIZE = 3;
+// bounds of the LM diagonal, as in Ceres
+const double MIN_DIAGONAL = 1e-6;
+const double MAX_DIAGONAL = 1e32;
+const double MIN_RELATIVE_DECREASE = 1e-3;
+// observations handed to the batch projection at once
+const int PROJECTION_CHUNK = 64;
+static_assert(BALLayout::POINT_STRIDE == 4, "the batch projection expects points padded to 4 doubles");
+
+double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// threads started once per solve and woken for every parallel loop, the calling thread takes part as thread 0
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads) : job_(NULL), generation_(0), num_active_(0), num_pending_(0),
+                                           stop_(false) {
+        for (int t = 1; t < num_threads; ++t)
+            threads_.push_back(std::thread(&ThreadPool::Worker, this, t));
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (size_t t = 0; t < threads_.size(); ++t)
+            threads_[t].join();
+    }
+
+    int num_threads() const { return static_cast<int>(threads_.size()) + 1; }
+
+    // job(thread) on the first num_active threads, returns once all of them are done
+    void Run(int num_active, const std::function<void(int)> &job) {
+        if (num_active <= 1) {
+            job(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &job;
+            num_active_ = num_active;
+            num_pending_ = num_active - 1;
+            ++generation_;
+        }
+        start_.notify_all();
+        job(0);
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return num_pending_ == 0; });
+        job_ = NULL;
+    }
+
+private:
+    void Worker(int thread) {
+        int seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+            if (thread >= num_active_)
+                continue;
+            const std::function<void(int)> *job = job_;
+            lock.unlock();
+            (*job)(thread);
+            lock.lock();
+            if (--num_pending_ == 0)
+                done_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable start_, done_;
+    const std::function<void(int)> *job_;
+    int generation_;
+    int num_active_;
+    int num_pending_;
+    bool stop_;
+};
+
+// f(begin, end, thread) over [0, n) in blocks of grain indices handed out to the threads of the pool as they
+// finish
+template<typename Function>
+void ParallelFor(ThreadPool &pool, int n, int grain, const Function &f) {
+    int num_blocks = (n + grain - 1) / grain;
+    int num_threads = std::max(1, std::min(pool.num_threads(), num_blocks));
+    if (num_threads == 1) {
+        if (n > 0)
+            f(0, n, 0);
+        return;
+    }
+    std::atomic<int> next_block(0);
+    pool.Run(num_threads, [&](int thread) {
+        for (int block = next_block++; block < num_blocks; block = next_block++)
+            f(block * grain, std::min(n, (block + 1) * grain), thread);
+    });
+}
+
+// E^T x and E y of an observation i, E = Jc^T Jp. the direct solvers store E, the iterative one keeps the
+// smaller Jc and multiplies through both Jacobians
+struct StoredE {
+    const double *e;
+
+    Vec3 TransposeTimes(int i, const double *x) const {
+        return Eigen::Map<const Mat93>(e + 27 * i).transpose() * Eigen::Map<const Vec9>(x);
+    }
+
+    Vec9 Times(int i, const Vec3 &y) const {
+        return Eigen::Map<const Mat93>(e + 27 * i) * y;
+    }
+};
+
+struct JacobianProductE {
+    const double *jacobian_camera;
+    const double *jacobian_point;
+
+    Vec3 TransposeTimes(int i, const double *x) const {
+        return Eigen::Map<const Mat23>(jacobian_point + 6 * i).transpose() *
+               (Eigen::Map<const Mat29>(jacobian_camera + 18 * i) * Eigen::Map<const Vec9>(x));
+    }
+
+    Vec9 Times(int i, const Vec3 &y) const {
+        return Eigen::Map<const Mat29>(jacobian_camera + 18 * i).transpose() *
+               (Eigen::Map<const Mat23>(jacobian_point + 6 * i) * y);
+    }
+};
+
+// dp = C^-1 (-gp - E^T dc) for the points [begin, end)
+template<typename E>
+void BackSubstitutePoints(const E &e, const BALLayout &layout, const double *c_inverse, const double *gradient_point,
+                          const double *dc, int begin, int end, double *dp) {
+    const int *camera_index = layout.camera_index();
+    const int *point_offsets = layout.point_offsets();
+    const int *point_observations = layout.point_observations();
+    for (int j = begin; j < end; ++j) {
+        Vec3 v = -Eigen::Map<const Vec3>(gradient_point + POINT_SIZE * j);
+        for (int l = point_offsets[j]; l < point_offsets[j + 1]; ++l) {
+            const int i = point_observations[l];
+            v -= e.TransposeTimes(i, dc + CAMERA_SIZE * camera_index[i]);
+        }
+        Eigen::Map<Vec3>(dp + POINT_SIZE * j) = Eigen::Map<const Mat33>(c_inverse + 9 * j) * v;
+    }
+}
+
+// scale of the residual and Jacobian so that their squares carry the Huber weight, and the cost of s = |r|^2
+inline double HuberWeight(double s, double *cost) {
+    if (s <= 1.0) {
+        *cost = 0.5 * s;
+        return 1.0;
+    }
+    double r = sqrt(s);
+    *cost = r - 0.5;
+    return sqrt(1.0 / r);
+}
+
+inline double ClampDiagonal(double d) {
+    return std::min(std::max(d, MIN_DIAGONAL), MAX_DIAGONAL);
+}
+}
+
+// everything the iterations need, sized once per solve
+struct BundleAdjuster::Workspace {
+    explicit Workspace(int num_threads) : pool(num_threads), pattern_analyzed(false) {}
+
+    ThreadPool pool;
+    // per observation in the order of the layout, scaled by the robust weight
+    std::vector<double> residuals;      // 2
+    std::vector<double> jacobian_point; // 2x3
+    // Jc^T Jp for the direct solvers, the iterative one keeps the smaller Jc instead
+    std::vector<double> e;              // 9x3
+    std::vector<double> jacobian_camera; // 2x9
+    // per camera
+    std::vector<double> b;              // 9x9, Jc^T Jc summed
+    std::vector<double> gradient_camera;
+    std::vector<double> camera_cost;
+    // per point
+    std::vector<double> c;              // 3x3, Jp^T Jp summed
+    std::vector<double> c_inverse;      // of the damped c
+    std::vector<double> gradient_point;
+    // the LM diagonal of the current step, and the step, packed as the parameters of a BALProblem
+    std::vector<double> damping;
+    std::vector<double> step;
+    // the parameters plus the step, padded as those of the layout
+    AlignedArray<double> candidate;
+
+    Eigen::MatrixXd dense_s;
+    Eigen::VectorXd rhs;
+    // values of the upper block rows of the sparse reduced system, 81 per neighbor
+    std::vector<double> sparse_blocks;
+    std::vector<Eigen::Triplet<double> > triplets;
+    Eigen::SparseMatrix<double> sparse_s;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Upper> sparse_solver;
+    bool pattern_analyzed;
+    // per thread, where each camera sits in the neighbor list of the row being assembled
+    std::vector<std::vector<int> > neighbor_position;
+
+    // conjugate gradients, the inverse preconditioner blocks per camera and the vectors of the iteration
+    std::vector<double> preconditioner; // 9x9
+    std::vector<double> point_product;
+    Eigen::VectorXd x, r, z, p, q;
+
+    size_t Bytes() const {
+        size_t doubles = residuals.capacity() + jacobian_point.capacity() + e.capacity() +
+                         jacobian_camera.capacity() + b.capacity() + gradient_camera.capacity() +
+                         camera_cost.capacity() + c.capacity() + c_inverse.capacity() + gradient_point.capacity() +
+                         damping.capacity() + step.capacity() + candidate.size() + dense_s.size() + rhs.size() +
+                         sparse_blocks.capacity() + preconditioner.capacity() + point_product.capacity() +
+                         x.size() + r.size() + z.size() + p.size() + q.size();
+        size_t bytes = doubles * sizeof(double) + triplets.capacity() * sizeof(Eigen::Triplet<double>) +
+                       sparse_s.nonZeros() * (sizeof(double) + sizeof(int));
+        for (size_t t = 0; t < neighbor_position.size(); ++t)
+            bytes += neighbor_position[t].capacity() * sizeof(int);
+        return bytes;
+    }
+};
+
+BundleAdjuster::BundleAdjuster(BALProblem *problem) : problem_(problem), layout_(*problem) {}
+
+bool BundleAdjuster::Solve(const Options &options, Summary *summary) {
+    *summary = Summary();
+    const bool sparse = options.linear_solver == "sparse_schur";
+    const bool iterative = options.linear_solver == "iterative_schur";
+    const bool schur_jacobi = options.preconditioner == "schur_jacobi";
+    if (problem_->camera_block_size() != CAMERA_SIZE) {
+        summary->termination = "quaternion cameras are not supported";
+        return false;
+    }
+    if (!sparse && !iterative && options.linear_solver != "dense_schur") {
+        summary->termination = "unknown linear solver " + options.linear_solver;
+        return false;
+    }
+    if (iterative && !schur_jacobi && options.preconditioner != "jacobi") {
+        summary->termination = "unknown preconditioner " + options.preconditioner;
+        return false;
+    }
+    const double start_time = Now();
+    const int num_cameras = problem_->num_cameras();
+    const int num_points = problem_->num_points();
+    const int num_observations = problem_->num_observations();
+    const int num_parameters = problem_->num_parameters();
+    const int num_padded_parameters = layout_.num_parameters();
+    const int num_threads = std::max(1, options.num_threads);
+    const int *camera_index = layout_.camera_index();
+    const int *point_index = layout_.point_index();
+    const double *observed_x = layout_.observed_x();
+    const double *observed_y = layout_.observed_y();
+    // the observations of camera a are [camera_offsets[a], camera_offsets[a + 1]), those of a point are listed
+    const int *camera_offsets = layout_.camera_offsets();
+    const int *point_offsets = layout_.point_offsets();
+    const int *point_observations = layout_.point_observations();
+    // the problem may have changed since the last solve
+    layout_.CopyParametersFrom(*problem_);
+    double *parameters = layout_.mutable_parameters();
+
+    // the cameras sharing a point with each camera, only the later ones since the upper triangle is enough
+    if (sparse && neighbor_offsets_.empty()) {
+        std::vector<int> seen(num_cameras, -1);
+        neighbor_offsets_.assign(1, 0);
+        for (int a = 0; a < num_cameras; ++a) {
+            std::vector<int> row(1, a);
+            seen[a] = a;
+            for (int k = camera_offsets[a]; k < camera_offsets[a + 1]; ++k) {
+                int j = point_index[k];
+                for (int l = point_offsets[j]; l < point_offsets[j + 1]; ++l) {
+                    int b = camera_index[point_observations[l]];
+                    if (b > a && seen[b] != a) {
+                        seen[b] = a;
+                        row.push_back(b);
+                    }
+                }
+            }
+            std::sort(row.begin(), row.end());
+            neighbors_.insert(neighbors_.end(), row.begin(), row.end());
+            neighbor_offsets_.push_back(neighbors_.size());
+        }
+    }
+
+    Workspace w(num_threads);
+    w.residuals.resize(2 * num_observations);
+    w.jacobian_point.resize(6 * num_observations);
+    if (iterative)
+        w.jacobian_camera.resize(18 * num_observations);
+    else
+        w.e.resize(27 * num_observations);
+    w.b.resize(81 * num_cameras);
+    w.gradient_camera.resize(CAMERA_SIZE * num_cameras);
+    w.camera_cost.resize(num_cameras);
+    w.c.resize(9 * num_points);
+    w.c_inverse.resize(9 * num_points);
+    w.gradient_point.resize(POINT_SIZE * num_points);
+    w.damping.resize(num_parameters);
+    w.step.resize(num_parameters);
+    w.candidate.Resize(num_padded_parameters);
+    w.rhs.resize(CAMERA_SIZE * num_cameras);
+    if (sparse) {
+        w.sparse_blocks.resize(81 * neighbors_.size());
+        w.sparse_s.resize(CAMERA_SIZE * num_cameras, CAMERA_SIZE * num_cameras);
+        w.neighbor_position.assign(num_threads, std::vector<int>(num_cameras, -1));
+    } else if (iterative) {
+        w.preconditioner.resize(81 * num_cameras);
+        w.point_product.resize(POINT_SIZE * num_points);
+    } else {
+        w.dense_s.resize(CAMERA_SIZE * num_cameras, CAMERA_SIZE * num_cameras);
+    }
+
+    const int grain = 16;
+
+    // cost of the padded parameters x, and with jacobians also the normal equations of the cameras and points.
+    // the observations of a camera and everything written for them are consecutive, they are projected in
+    // chunks by the vector kernel of the CPU
+    const BatchProjectionKernel projection_kernel = BestBatchProjectionKernel();
+    auto evaluate = [&](const double *x, bool jacobians) -> double {
+        ParallelFor(w.pool, num_cameras, 1, [&](int begin, int end, int) {
+            for (int a = begin; a < end; ++a) {
+                const double *camera = x + layout_.camera_offset(a);
+                Eigen::Map<Mat99> b(w.b.data() + 81 * a);
+                Eigen::Map<Vec9> gc(w.gradient_camera.data() + CAMERA_SIZE * a);
+                if (jacobians) {
+                    b.setZero();
+                    gc.setZero();
+                }
+                double rotation[18];
+                CameraRotation(camera, rotation);
+                double cost = 0;
+                for (int chunk = camera_offsets[a]; chunk < camera_offsets[a + 1]; chunk += PROJECTION_CHUNK) {
+                    const int n = std::min(PROJECTION_CHUNK, camera_offsets[a + 1] - chunk);
+                    double residuals[2 * PROJECTION_CHUNK];
+                    double jacobians_camera[18 * PROJECTION_CHUNK], jacobians_point[6 * PROJECTION_CHUNK];
+                    ProjectCameraObservations(projection_kernel, camera, rotation, x + layout_.point_offset(0),
+                                              point_index + chunk, observed_x + chunk, observed_y + chunk, n,
+                                              residuals, jacobians ? jacobians_camera : NULL,
+                                              jacobians ? jacobians_point : NULL);
+                    for (int k = 0; k < n; ++k) {
+                        const int i = chunk + k;
+                        Vec2 r = Eigen::Map<const Vec2>(residuals + 2 * k);
+                        double weight = 1.0, observation_cost = 0.5 * r.squaredNorm();
+                        if (options.robustify)
+                            weight = HuberWeight(r.squaredNorm(), &observation_cost);
+                        cost += observation_cost;
+                        if (!jacobians)
+                            continue;
+                        Mat29 jc = weight * Eigen::Map<const Mat29>(jacobians_camera + 18 * k);
+                        Mat23 jp = weight * Eigen::Map<const Mat23>(jacobians_point + 6 * k);
+                        r *= weight;
+                        Eigen::Map<Vec2>(w.residuals.data() + 2 * i) = r;
+                        Eigen::Map<Mat23>(w.jacobian_point.data() + 6 * i) = jp;
+                        if (iterative)
+                            Eigen::Map<Mat29>(w.jacobian_camera.data() + 18 * i) = jc;
+                        else
+                            Eigen::Map<Mat93>(w.e.data() + 27 * i).noalias() = jc.transpose() * jp;
+                        b.noalias() += jc.transpose() * jc;
+                        gc.noalias() += jc.transpose() * r;
+                    }
+                }
+                w.camera_cost[a] = cost;
+            }
+        });
+        if (jacobians) {
+            ParallelFor(w.pool, num_points, 256, [&](int begin, int end, int) {
+                for (int j = begin; j < end; ++j) {
+                    Eigen::Map<Mat33> c(w.c.data() + 9 * j);
+                    Eigen::Map<Vec3> gp(w.gradient_point.data() + POINT_SIZE * j);
+                    c.setZero();
+                    gp.setZero();
+                    for (int l = point_offsets[j]; l < point_offsets[j + 1]; ++l) {
+                        const int i = point_observations[l];
+                        Eigen::Map<const Mat23> jp(w.jacobian_point.data() + 6 * i);
+                        c.noalias() += jp.transpose() * jp;
+                        gp.noalias() += jp.transpose() * Eigen::Map<const Vec2>(w.residuals.data() + 2 * i);
+                    }
+                }
+            });
+        }
+        double cost = 0;
+        for (int a = 0; a < num_cameras; ++a)
+            cost += w.camera_cost[a];
+        return cost;
+    };
+
+    const StoredE stored_e = {w.e.data()};
+    const JacobianProductE product_e = {w.jacobian_camera.data(), w.jacobian_point.data()};
+
+    // y = S x = (B + D) x - E C^-1 E^T x, through the points without forming S
+    auto schur_times = [&](const Eigen::VectorXd &x, Eigen::VectorXd &y) {
+        ParallelFor(w.pool, num_points, 256, [&](int begin, int end, int) {
+            for (int j = begin; j < end; ++j) {
+                Vec3 v = Vec3::Zero();
+                for (int l = point_offsets[j]; l < point_offsets[j + 1]; ++l) {
+                    const int i = point_observations[l];
+                    v += product_e.TransposeTimes(i, x.data() + CAMERA_SIZE * camera_index[i]);
+                }
+                Eigen::Map<Vec3>(w.point_product.data() + POINT_SIZE * j) =
+                        Eigen::Map<const Mat33>(w.c_inverse.data() + 9 * j) * v;
+            }
+        });
+        ParallelFor(w.pool, num_cameras, grain, [&](int begin, int end, int) {
+            for (int a = begin; a < end; ++a) {
+                Eigen::Map<const Vec9> xa(x.data() + CAMERA_SIZE * a);
+                Vec9 ya = Eigen::Map<const Mat99>(w.b.data() + 81 * a) * xa +
+                          Eigen::Map<const Vec9>(w.damping.data() + CAMERA_SIZE * a).cwiseProduct(xa);
+                for (int i = camera_offsets[a]; i < camera_offsets[a + 1]; ++i) {
+                    const int j = point_index[i];
+                    ya -= product_e.Times(i, Eigen::Map<const Vec3>(w.point_product.data() + POINT_SIZE * j));
+                }
+                y.segment<9>(CAMERA_SIZE * a) = ya;
+            }
+        });
+    };
+
+    auto precondition = [&](const Eigen::VectorXd &r, Eigen::VectorXd &z) {
+        for (int a = 0; a < num_cameras; ++a)
+            z.segment<9>(CAMERA_SIZE * a) = Eigen::Map<const Mat99>(w.preconditioner.data() + 81 * a) *
+                                            r.segment<9>(CAMERA_SIZE * a);
+    };
+
+    // S dc = rhs by preconditioned conjugate gradients, to a residual of eta |rhs|
+    auto solve_iterative = [&](double eta, Eigen::VectorXd &dc, int *iterations) -> bool {
+        // the rhs and the inverse preconditioner blocks, one camera at a time
+        ParallelFor(w.pool, num_cameras, grain, [&](int begin, int end, int) {
+            for (int a = begin; a < end; ++a) {
+                Mat99 m = Eigen::Map<const Mat99>(w.b.data() + 81 * a);
+                m.diagonal() += Eigen::Map<const Vec9>(w.damping.data() + CAMERA_SIZE * a);
+                Vec9 rhs = -Eigen::Map<const Vec9>(w.gradient_camera.data() + CAMERA_SIZE * a);
+                for (int i = camera_offsets[a]; i < camera_offsets[a + 1]; ++i) {
+                    const int j = point_index[i];
+                    Eigen::Map<const Mat33> c_inverse(w.c_inverse.data() + 9 * j);
+                    rhs += product_e.Times(i, c_inverse *
+                                              Eigen::Map<const Vec3>(w.gradient_point.data() + POINT_SIZE * j));
+                    if (!schur_jacobi)
+                        continue;
+                    // the diagonal block of S only couples the observations of this camera
+                    Mat93 ec = Eigen::Map<const Mat29>(w.jacobian_camera.data() + 18 * i).transpose() *
+                               (Eigen::Map<const Mat23>(w.jacobian_point.data() + 6 * i) * c_inverse);
+                    for (int l = point_offsets[j]; l < point_offsets[j + 1]; ++l) {
+                        const int other = point_observations[l];
+                        if (camera_index[other] != a)
+                            continue;
+                        Mat93 e = Eigen::Map<const Mat29>(w.jacobian_camera.data() + 18 * other).transpose() *
+                                  Eigen::Map<const Mat23>(w.jacobian_point.data() + 6 * other);
+                        m.noalias() -= ec * e.transpose();
+                    }
+                }
+                Eigen::Map<Mat99> inverse(w.preconditioner.data() + 81 * a);
+                Eigen::LLT<Mat99> llt(m);
+                if (llt.info() == Eigen::Success)
+                    inverse = llt.solve(Mat99::Identity());
+                else
+                    inverse = m.diagonal().cwiseInverse().asDiagonal();
+                w.rhs.segment<9>(CAMERA_SIZE * a) = rhs;
+            }
+        });
+
+        const int n = CAMERA_SIZE * num_cameras;
+        w.x.setZero(n);
+        w.r = w.rhs;
+        w.z.resize(n);
+        w.q.resize(n);
+        precondition(w.r, w.z);
+        w.p = w.z;
+        double rz = w.r.dot(w.z);
+        const double tolerance = eta * w.rhs.norm();
+        *iterations = 0;
+        while (*iterations < options.max_linear_solver_iterations && w.r.norm() > tolerance) {
+            schur_times(w.p, w.q);
+            const double pq = w.p.dot(w.q);
+            // S is positive definite in exact arithmetic, a non-positive curvature means the iteration broke down
+            if (!(pq > 0))
+                break;
+            const double alpha = rz / pq;
+            w.x += alpha * w.p;
+            w.r -= alpha * w.q;
+            precondition(w.r, w.z);
+            const double rz_next = w.r.dot(w.z);
+            w.p = w.z + (rz_next / rz) * w.p;
+            rz = rz_next;
+            ++*iterations;
+        }
+        dc = w.x;
+        return *iterations > 0 || w.rhs.norm() <= tolerance;
+    };
+
+    // solves (J^T J + D / radius) step = -J^T r by eliminating the points, false if the system is not positive
+    // definite. eta is the relative accuracy the iterative solver stops at
+    auto compute_step = [&](double radius, double eta, int *linear_solver_iterations) -> bool {
+        ParallelFor(w.pool, num_points, 256, [&](int begin, int end, int) {
+            for (int j = begin; j < end; ++j) {
+                Mat33 c = Eigen::Map<const Mat33>(w.c.data() + 9 * j);
+                double *d = w.damping.data() + CAMERA_SIZE * num_cameras + POINT_SIZE * j;
+                for (int k = 0; k < 3; ++k) {
+                    d[k] = ClampDiagonal(c(k, k)) / radius;
+                    c(k, k) += d[k];
+                }
+                Eigen::Map<Mat33>(w.c_inverse.data() + 9 * j) = c.inverse();
+            }
+        });
+
+        Eigen::VectorXd dc;
+        *linear_solver_iterations = 0;
+        if (iterative) {
+            ParallelFor(w.pool, num_cameras, grain, [&](int begin, int end, int) {
+                for (int a = begin; a < end; ++a) {
+                    double *d = w.damping.data() + CAMERA_SIZE * a;
+                    for (int k = 0; k < 9; ++k)
+                        d[k] = ClampDiagonal(w.b[81 * a + 10 * k]) / radius;
+                }
+            });
+            if (!solve_iterative(eta, dc, linear_solver_iterations))
+                return false;
+        } else {
+            // S = B + D - sum E C^-1 E^T and rhs = -gc + E C^-1 gp, one block row per camera
+            if (!sparse)
+                w.dense_s.setZero();
+            ParallelFor(w.pool, num_cameras, grain, [&](int begin, int end, int thread) {
+                for (int a = begin; a < end; ++a) {
+                    double *d = w.damping.data() + CAMERA_SIZE * a;
+                    Mat99 diagonal = Eigen::Map<const Mat99>(w.b.data() + 81 * a);
+                    for (int k = 0; k < 9; ++k) {
+                        d[k] = ClampDiagonal(diagonal(k, k)) / radius;
+                        diagonal(k, k) += d[k];
+                    }
+                    Vec9 rhs = -Eigen::Map<const Vec9>(w.gradient_camera.data() + CAMERA_SIZE * a);
+
+                    double *row = NULL;
+                    std::vector<int> *position = NULL;
+                    if (sparse) {
+                        position = &w.neighbor_position[thread];
+                        for (int n = neighbor_offsets_[a]; n < neighbor_offsets_[a + 1]; ++n)
+                            (*position)[neighbors_[n]] = n;
+                        row = w.sparse_blocks.data() + 81 * neighbor_offsets_[a];
+                        memset(row, 0, 81 * sizeof(double) * (neighbor_offsets_[a + 1] - neighbor_offsets_[a]));
+                    }
+                    auto block = [&](int b) -> Eigen::Map<Mat99, 0, Eigen::OuterStride<> > {
+                        if (sparse)
+                            return Eigen::Map<Mat99, 0, Eigen::OuterStride<> >(
+                                    w.sparse_blocks.data() + 81 * (*position)[b], Eigen::OuterStride<>(9));
+                        return Eigen::Map<Mat99, 0, Eigen::OuterStride<> >(
+                                &w.dense_s(CAMERA_SIZE * a, CAMERA_SIZE * b), Eigen::OuterStride<>(w.dense_s.rows()));
+                    };
+                    // the dense matrix is column major, its blocks are written transposed,
+                    // which S being symmetric allows
+                    if (sparse)
+                        block(a) += diagonal;
+                    else
+                        block(a) += diagonal.transpose();
+
+                    for (int i = camera_offsets[a]; i < camera_offsets[a + 1]; ++i) {
+                        const int j = point_index[i];
+                        Mat93 ec = Eigen::Map<const Mat93>(w.e.data() + 27 * i) *
+                                   Eigen::Map<const Mat33>(w.c_inverse.data() + 9 * j);
+                        rhs.noalias() += ec * Eigen::Map<const Vec3>(w.gradient_point.data() + POINT_SIZE * j);
+                        for (int l = point_offsets[j]; l < point_offsets[j + 1]; ++l) {
+                            const int other = point_observations[l];
+                            const int b = camera_index[other];
+                            if (sparse && b < a)
+                                continue;
+                            Eigen::Map<const Mat93> e(w.e.data() + 27 * other);
+                            if (sparse)
+                                block(b).noalias() -= ec * e.transpose();
+                            else
+                                block(b).noalias() -= e * ec.transpose();
+                        }
+                    }
+                    w.rhs.segment<9>(CAMERA_SIZE * a) = rhs;
+                }
+            });
+
+            if (sparse) {
+                w.triplets.clear();
+                w.triplets.reserve(81 * neighbors_.size());
+                for (int a = 0; a < num_cameras; ++a) {
+                    for (int n = neighbor_offsets_[a]; n < neighbor_offsets_[a + 1]; ++n) {
+                        const double *values = w.sparse_blocks.data() + 81 * n;
+                        const int b = neighbors_[n];
+                        for (int r = 0; r < 9; ++r)
+                            for (int c = (a == b ? r : 0); c < 9; ++c)
+                                w.triplets.push_back(
+                                        Eigen::Triplet<double>(9 * a + r, 9 * b + c, values[9 * r + c]));
+                    }
+                }
+                w.sparse_s.setFromTriplets(w.triplets.begin(), w.triplets.end());
+                if (!w.pattern_analyzed) {
+                    w.sparse_solver.analyzePattern(w.sparse_s);
+                    w.pattern_analyzed = true;
+                }
+                w.sparse_solver.factorize(w.sparse_s);
+                if (w.sparse_solver.info() != Eigen::Success)
+                    return false;
+                dc = w.sparse_solver.solve(w.rhs);
+            } else {
+                Eigen::LLT<Eigen::MatrixXd> llt(w.dense_s);
+                if (llt.info() != Eigen::Success)
+                    return false;
+                dc = llt.solve(w.rhs);
+            }
+        }
+        if (!dc.allFinite())
+            return false;
+        memcpy(w.step.data(), dc.data(), sizeof(double) * CAMERA_SIZE * num_cameras);
+
+        // dp = C^-1 (-gp - E^T dc)
+        double *dp = w.step.data() + CAMERA_SIZE * num_cameras;
+        ParallelFor(w.pool, num_points, 256, [&](int begin, int end, int) {
+            if (iterative)
+                BackSubstitutePoints(product_e, layout_, w.c_inverse.data(), w.gradient_point.data(), dc.data(),
+                                     begin, end, dp);
+            else
+                BackSubstitutePoints(stored_e, layout_, w.c_inverse.data(), w.gradient_point.data(), dc.data(),
+                                     begin, end, dp);
+        });
+        return true;
+    };
+
+    double t = Now();
+    double cost = evaluate(parameters, true);
+    summary->jacobian_time += Now() - t;
+    summary->initial_cost = cost;
+    Eigen::Map<const Eigen::VectorXd> gc(w.gradient_camera.data(), w.gradient_camera.size());
+    Eigen::Map<const Eigen::VectorXd> gp(w.gradient_point.data(), w.gradient_point.size());
+    double gradient_max_norm = std::max(gc.size() ? gc.cwiseAbs().maxCoeff() : 0.0,
+                                        gp.size() ? gp.cwiseAbs().maxCoeff() : 0.0);
+    double radius = options.initial_trust_region_radius;
+    double decrease_factor = 2.0;
+    // forcing sequence of the inexact Newton steps, choice 2 of Eisenstat and Walker,
+    // eta_k = 0.9 (|g_k| / |g_k-1|)^2 bounded by options.eta, and from below by 1e-3 options.eta so that a
+    // sudden drop of the gradient does not ask CG for a solve to machine precision
+    double eta = options.eta;
+    double gradient_norm = sqrt(gc.squaredNorm() + gp.squaredNorm());
+
+    IterationSummary first;
+    first.iteration = 0;
+    first.cost = cost;
+    first.cost_change = 0;
+    first.gradient_max_norm = gradient_max_norm;
+    first.step_norm = 0;
+    first.relative_decrease = 0;
+    first.trust_region_radius = radius;
+    first.step_is_successful = true;
+    first.linear_solver_iterations = 0;
+    first.iteration_time = first.cumulative_time = Now() - start_time;
+    summary->iterations.push_back(first);
+    if (options.minimizer_progress_to_stdout) {
+        printf("iter      cost      cost_change  |gradient|   |step|    tr_ratio  tr_radius  ls_iter  iter_time  "
+               "total_time\n");
+        printf("% 4d % 8e   % 3.2e   % 3.2e  % 3.2e  % 3.2e % 3.2e  % 6d   % 3.2e    % 3.2e\n", 0, cost, 0.0,
+               gradient_max_norm, 0.0, 0.0, radius, 0, first.iteration_time, first.cumulative_time);
+    }
+
+    if (gradient_max_norm <= options.gradient_tolerance)
+        summary->termination = "gradient tolerance reached";
+    for (int iteration = 1; summary->termination.empty(); ++iteration) {
+        if (iteration > options.max_num_iterations) {
+            summary->termination = "maximum number of iterations reached";
+            break;
+        }
+        const double iteration_start = Now();
+        IterationSummary it;
+        it.iteration = iteration;
+        it.trust_region_radius = radius;
+
+        t = Now();
+        bool solved = compute_step(radius, eta, &it.linear_solver_iterations);
+        summary->linear_solver_time += Now() - t;
+        summary->linear_solver_iterations += it.linear_solver_iterations;
+
+        double new_cost = std::numeric_limits<double>::infinity(), model_decrease = 0, step_norm = 0;
+        if (solved) {
+            Eigen::Map<const Eigen::VectorXd> step(w.step.data(), num_parameters);
+            Eigen::Map<const Eigen::VectorXd> damping(w.damping.data(), num_parameters);
+            Eigen::VectorXd gradient(num_parameters);
+            gradient << gc, gp;
+            model_decrease = 0.5 * (step.dot(damping.cwiseProduct(step)) - gradient.dot(step));
+            step_norm = step.norm();
+            layout_.Unpack(w.step.data(), w.candidate.data());
+            Eigen::Map<Eigen::VectorXd>(w.candidate.data(), num_padded_parameters) +=
+                    Eigen::Map<const Eigen::VectorXd>(parameters, num_padded_parameters);
+            t = Now();
+            new_cost = evaluate(w.candidate.data(), false);
+            summary->residual_time += Now() - t;
+        }
+
+        double relative_decrease = model_decrease > 0 ? (cost - new_cost) / model_decrease : 0;
+        it.cost_change = cost - new_cost;
+        it.step_norm = step_norm;
+        it.relative_decrease = relative_decrease;
+        it.step_is_successful = solved && std::isfinite(new_cost) && relative_decrease > MIN_RELATIVE_DECREASE;
+
+        if (it.step_is_successful) {
+            summary->num_successful_steps++;
+            const double x_norm = Eigen::Map<const Eigen::VectorXd>(parameters, num_padded_parameters).norm();
+            memcpy(parameters, w.candidate.data(), sizeof(double) * num_padded_parameters);
+            radius = std::min(options.max_trust_region_radius,
+                              radius / std::max(1.0 / 3.0, 1.0 - pow(2.0 * relative_decrease - 1.0, 3)));
+            decrease_factor = 2.0;
+            t = Now();
+            cost = evaluate(parameters, true);
+            summary->jacobian_time += Now() - t;
+            gradient_max_norm = std::max(gc.size() ? gc.cwiseAbs().maxCoeff() : 0.0,
+                                         gp.size() ? gp.cwiseAbs().maxCoeff() : 0.0);
+            const double previous_norm = gradient_norm;
+            gradient_norm = sqrt(gc.squaredNorm() + gp.squaredNorm());
+            double next_eta = 0.9 * pow(gradient_norm / previous_norm, 2);
+            // safeguard against a too fast decrease when the previous eta was large
+            if (0.9 * eta * eta > 0.1)
+                next_eta = std::max(next_eta, 0.9 * eta * eta);
+            eta = std::max(std::min(options.eta, next_eta), 1e-3 * options.eta);
+            if (fabs(it.cost_change) <= options.function_tolerance * cost)
+                summary->termination = "function tolerance reached";
+            else if (gradient_max_norm <= options.gradient_tolerance)
+                summary->termination = "gradient tolerance reached";
+            else if (step_norm <= options.parameter_tolerance * (x_norm + options.parameter_tolerance))
+                summary->termination = "parameter tolerance reached";
+        } else {
+            summary->num_unsuccessful_steps++;
+            radius /= decrease_factor;
+            decrease_factor *= 2.0;
+            if (radius < options.min_trust_region_radius)
+                summary->termination = "trust region radius below the minimum";
+        }
+
+        it.cost = cost;
+        it.gradient_max_norm = gradient_max_norm;
+        it.iteration_time = Now() - iteration_start;
+        it.cumulative_time = Now() - start_time;
+        summary->iterations.push_back(it);
+        if (options.minimizer_progress_to_stdout)
+            printf("% 4d % 8e   % 3.2e   % 3.2e  % 3.2e  % 3.2e % 3.2e  % 6d   % 3.2e    % 3.2e\n", iteration, cost,
+                   it.cost_change, gradient_max_norm, step_norm, relative_decrease, radius,
+                   it.linear_solver_iterations, it.iteration_time, it.cumulative_time);
+    }
+
+    layout_.CopyParametersTo(problem_);
+    summary->final_cost = cost;
+    summary->total_time = Now() - start_time;
+    summary->workspace_bytes = w.Bytes() + layout_.Bytes();
+    return true;
+}
+
+std::string BundleAdjuster::Summary::BriefReport() const {
+    char line[256];
+    snprintf(line, sizeof(line), "Iterations: %d, Initial cost: %e, Final cost: %e, Termination: %s",
+             int(iterations.size()) - 1, initial_cost, final_cost, termination.c_str());
+    return line;
+}
+
+std::string BundleAdjuster::Summary::FullReport() const {
+    char text[1024];
+    int num_iterations = std::max(int(iterations.size()) - 1, 1);
+    snprintf(text, sizeof(text),
+             "\nSolver Summary\n\n"
+             "Initial                      %e\n"
+             "Final                        %e\n"
+             "Change                       %e\n\n"
+             "Successful steps                 %d\n"
+             "Unsuccessful steps               %d\n"
+             "Linear solver iterations         %d\n"
+             "Workspace memory             %.1f MB\n\n"
+             "Time (in seconds):\n"
+             "  Residual evaluation        %.6f\n"
+             "  Jacobian evaluation        %.6f\n"
+             "  Linear solver              %.6f\n"
+             "Total                        %.6f\n"
+             "Per iteration                %.6f\n\n"
+             "Termination:                 %s\n",
+             initial_cost, final_cost, initial_cost - final_cost, num_successful_steps, num_unsuccessful_steps,
+             linear_solver_iterations, workspace_bytes / (1024.0 * 1024.0),
+             residual_time, jacobian_time, linear_solver_time, total_time, total_time / num_iterations,
+             termination.c_str());
+    return text;
+}
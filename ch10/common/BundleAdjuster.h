@@ -0,0 +1,108 @@
+#ifndef BUNDLEADJUSTER_H
+#define BUNDLEADJUSTER_H
+
+#include <string>
+#include <vector>
+#include "BALProblem.h"
+#include "BALLayout.h"
+
+// Levenberg-Marquardt bundle adjustment working directly on the arrays of a BALProblem, without Ceres.
+// Every observation contributes a 2x9 camera and a 2x3 point block to the Jacobian. The points are
+// eliminated with the Schur complement, the reduced camera system is factored with a dense or a sparse
+// Cholesky, or solved with preconditioned conjugate gradients without ever forming it, and the points are
+// recovered by back substitution. The cost is 0.5 * sum of squared residuals as in Ceres, so the numbers
+// of the two solvers can be compared directly.
+// The solver works on a BALLayout copy of the problem, so the passes over the observations of a camera read
+// and write consecutive memory, and writes the parameters back to the problem when it is done.
+// Only angle-axis cameras are supported, i.e. a BALProblem loaded with use_quaternions = false.
+class BundleAdjuster {
+public:
+    struct Options {
+        Options() : max_num_iterations(10), num_threads(1), linear_solver("dense_schur"),
+                    preconditioner("schur_jacobi"), eta(0.1), max_linear_solver_iterations(500), robustify(false),
+                    initial_trust_region_radius(1e4), max_trust_region_radius(1e16), min_trust_region_radius(1e-32),
+                    function_tolerance(1e-6), gradient_tolerance(1e-10), parameter_tolerance(1e-8),
+                    minimizer_progress_to_stdout(true) {}
+
+        int max_num_iterations;
+        int num_threads;
+        // dense_schur, sparse_schur or iterative_schur
+        std::string linear_solver;
+        // for iterative_schur, jacobi (the camera blocks of J^T J) or schur_jacobi (the diagonal blocks of
+        // the reduced system)
+        std::string preconditioner;
+        // the largest relative residual conjugate gradients stops at, the forcing sequence of the inexact
+        // Newton steps tightens it as the gradient shrinks
+        double eta;
+        int max_linear_solver_iterations;
+        // Huber loss with a scale of 1, as ceres_bundle uses
+        bool robustify;
+
+        double initial_trust_region_radius;
+        double max_trust_region_radius;
+        double min_trust_region_radius;
+
+        double function_tolerance;
+        double gradient_tolerance;
+        double parameter_tolerance;
+
+        bool minimizer_progress_to_stdout;
+    };
+
+    struct IterationSummary {
+        int iteration;
+        double cost;
+        double cost_change;
+        double gradient_max_norm;
+        double step_norm;
+        double relative_decrease;
+        double trust_region_radius;
+        bool step_is_successful;
+        // conjugate gradient iterations, 0 for the direct solvers
+        int linear_solver_iterations;
+        // seconds spent in this iteration and since the start
+        double iteration_time;
+        double cumulative_time;
+    };
+
+    struct Summary {
+        Summary() : initial_cost(0), final_cost(0), num_successful_steps(0), num_unsuccessful_steps(0),
+                    total_time(0), jacobian_time(0), linear_solver_time(0), residual_time(0),
+                    linear_solver_iterations(0), workspace_bytes(0) {}
+
+        double initial_cost;
+        double final_cost;
+        int num_successful_steps;
+        int num_unsuccessful_steps;
+        std::string termination;
+        std::vector<IterationSummary> iterations;
+        // seconds
+        double total_time;
+        double jacobian_time;
+        double linear_solver_time;
+        double residual_time;
+        int linear_solver_iterations;
+        // memory of the Jacobians, normal equations and linear solver and of the reordered copy of the problem
+        size_t workspace_bytes;
+
+        std::string BriefReport() const;
+
+        std::string FullReport() const;
+    };
+
+    explicit BundleAdjuster(BALProblem *problem);
+
+    // optimizes the cameras and points of the problem in place, false if the options are invalid
+    bool Solve(const Options &options, Summary *summary);
+
+private:
+    struct Workspace;
+
+    BALProblem *problem_;
+    // the observations sorted by camera, the per observation arrays of the workspace follow its order
+    BALLayout layout_;
+    // for the sparse reduced system, the cameras that share a point with each camera, itself included
+    std::vector<int> neighbor_offsets_, neighbors_;
+};
+
+#endif // BundleAdjuster.h
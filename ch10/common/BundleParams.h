@@ -14,8 +14,10 @@ public:
 
 public:
     string input;
+    bool no_cache; // always parse the text file, without reading or writing <input>.cache
     string trust_region_strategy;
     string linear_solver;
+    string preconditioner; // for iterative_schur
     string sparse_linear_algebra_library;
     string dense_linear_algebra_library;
 
@@ -23,7 +25,8 @@ public:
     string ordering; // marginalization ..
 
     bool robustify; // loss function
-    // double eta;
+    bool analytic_jacobian; // hand written derivatives instead of autodiff
+    double eta; // relative accuracy of the iterative linear solver
     int num_threads;  // default = 1
     int num_iterations;
 
@@ -41,21 +44,31 @@ public:
 
 };
 
-BundleParams::BundleParams(int argc, char **argv) {
+// inline, the header is included by the programs and by the BundleProblem library they link to
+inline BundleParams::BundleParams(int argc, char **argv) {
     arg.param("input", input, "", "file which will be processed");
+    arg.param("no_cache", no_cache, false, "Parse the input text even if its binary cache is up to date.");
     arg.param("trust_region_strategy", trust_region_strategy, "levenberg_marquardt",
               "Options are: levenberg_marquardt, dogleg.");
     arg.param("linear_solver", linear_solver,
-              "dense_schur",                             // iterative schur and cgnr(pcg) leave behind...
-              "Options are: sparse_schur, dense_schur, sparse_normal_cholesky");
+              "dense_schur",
+              "Options are: sparse_schur, dense_schur, iterative_schur, sparse_normal_cholesky. "
+              "native_bundle supports the first three.");
+    arg.param("preconditioner", preconditioner, "schur_jacobi",
+              "Preconditioner of iterative_schur, options are: jacobi, schur_jacobi.");
+    arg.param("eta", eta, 0.1, "Relative residual at which iterative_schur stops, "
+            "the native solver tightens it as the gradient decreases.");
 
     arg.param("sparse_linear_algebra_library", sparse_linear_algebra_library, "suite_sparse",
               "Options are: suite_sparse and cx_sparse.");
     arg.param("dense_linear_algebra_library", dense_linear_algebra_library, "eigen", "Options are: eigen and lapack.");
 
 
-    arg.param("ordering", ordering, "automatic", "Options are: automatic, user.");
+    arg.param("ordering", ordering, "automatic",
+              "Options are: automatic, user, point_count, nested_dissection, and compare to time them all.");
     arg.param("robustify", robustify, false, "Use a robust loss function");
+    arg.param("analytic_jacobian", analytic_jacobian, false,
+              "Use the analytic Jacobian of the reprojection error instead of automatic differentiation");
 
 
     arg.param("num_threads", num_threads, 1, "Number of threads.");
@@ -0,0 +1,101 @@
+#include "BundleProblem.h"
+
+#include <cstdlib>
+#include <vector>
+#include "CameraOrdering.h"
+#include "../SnavelyReprojectionError.h"
+
+using namespace ceres;
+
+void PerturbProblem(BALProblem *bal_problem, const BundleParams &params) {
+    srand(static_cast<unsigned int>(params.random_seed));
+    bal_problem->Normalize();
+    bal_problem->Perturb(params.rotation_sigma, params.translation_sigma, params.point_sigma);
+}
+
+void BuildProblem(BALProblem *bal_problem, Problem *problem, const BundleParams &params) {
+    const int point_block_size = bal_problem->point_block_size();
+    const int camera_block_size = bal_problem->camera_block_size();
+    double *points = bal_problem->mutable_points();
+    double *cameras = bal_problem->mutable_cameras();
+//    observations is 2*num_observations long array observations
+//    [u_1,u_2,...,u_n], where each u_i is two dimensional, the x and y position of the observation.
+    const double *observations = bal_problem->observations();
+
+    for (int i = 0; i < bal_problem->num_observations(); ++i) {
+        CostFunction *cost_function;
+//        each residual block takes a point and camera as input
+//        and outputs a 2 dimensional residual
+        if (params.analytic_jacobian)
+            cost_function = SnavelyReprojectionErrorAnalytic::Create(observations[2 * i + 0],
+                                                                     observations[2 * i + 1]);
+        else
+            cost_function = SnavelyReprojectionError::Create(observations[2 * i + 0], observations[2 * i + 1]);
+//        if enabled use Huber's loss function
+        LossFunction *loss_function = params.robustify ? new HuberLoss(1.0) : nullptr;
+//        each observation corresponds to a pair of a camera and a point
+//        which are identified by camera_index()[i] and point_index()[i] respectively
+        double *camera = cameras + camera_block_size * bal_problem->camera_index()[i];
+        double *point = points + point_block_size * bal_problem->point_index()[i];
+
+        problem->AddResidualBlock(cost_function, loss_function, camera, point);
+    }
+}
+
+bool setOrdering(BALProblem *bal_problem, Solver::Options *options, const std::string &ordering_type) {
+    const int num_points = bal_problem->num_points();
+    const int point_block_size = bal_problem->point_block_size();
+    double *points = bal_problem->mutable_points();
+    const int num_cameras = bal_problem->num_cameras();
+    const int cameras_block_size = bal_problem->camera_block_size();
+    double *cameras = bal_problem->mutable_cameras();
+
+    if (ordering_type == "automatic") {
+        options->linear_solver_ordering.reset();
+        return true;
+    }
+//    the group of every camera, user puts them all in one
+    std::vector<int> camera_groups;
+    if (ordering_type == "user")
+        camera_groups.assign(num_cameras, 1);
+    else if (ordering_type == "point_count")
+        camera_groups = CameraGroupsByPointCount(*bal_problem);
+    else if (ordering_type == "nested_dissection")
+        camera_groups = CameraGroupsByNestedDissection(*bal_problem);
+    else
+        return false;
+
+    auto *ordering = new ParameterBlockOrdering;
+//    the points come before the cameras
+    for (int i = 0; i < num_points; ++i) {
+        ordering->AddElementToGroup(points + point_block_size * i, 0);
+    }
+    for (int i = 0; i < num_cameras; ++i) {
+        ordering->AddElementToGroup(cameras + cameras_block_size * i, camera_groups[i]);
+    }
+//    the options own the ordering from here on
+    options->linear_solver_ordering.reset(ordering);
+    return true;
+}
+
+void setSolverOptionsFromFlags(BALProblem *bal_problem, const BundleParams &params, Solver::Options *options) {
+    options->max_num_iterations = params.num_iterations;
+    options->minimizer_progress_to_stdout = true;
+    options->num_threads = params.num_threads;
+
+//    选取下降策略
+    CHECK(StringToTrustRegionStrategyType(params.trust_region_strategy, &options->trust_region_strategy_type));
+
+//    选取linear solver
+    CHECK(StringToLinearSolverType(params.linear_solver, &options->linear_solver_type));
+    CHECK(StringToPreconditionerType(params.preconditioner, &options->preconditioner_type));
+    options->eta = params.eta;
+    CHECK(StringToSparseLinearAlgebraLibraryType(params.sparse_linear_algebra_library,
+                                                 &options->sparse_linear_algebra_library_type));
+    CHECK(StringToDenseLinearAlgebraLibraryType(params.dense_linear_algebra_library,
+                                                &options->dense_linear_algebra_library_type));
+
+//    设置变量排序, compare sets it for every run
+    if (params.ordering != "compare")
+        setOrdering(bal_problem, options, params.ordering);
+}
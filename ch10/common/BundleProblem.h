@@ -0,0 +1,27 @@
+#ifndef BUNDLEPROBLEM_H
+#define BUNDLEPROBLEM_H
+
+#include <string>
+#include <ceres/ceres.h>
+#include "BALProblem.h"
+#include "BundleParams.h"
+
+// the ceres side of the command line programs: the problem built from a BAL file and the solver options of the
+// flags, shared so that every program solves the problem the same way
+
+// orderings setOrdering accepts
+const char *const ORDERINGS[] = {"automatic", "user", "point_count", "nested_dissection"};
+
+// normalizes the problem and perturbs it with the seed of the flags, the same start for every run
+void PerturbProblem(BALProblem *bal_problem, const BundleParams &params);
+
+// one residual block per observation, with the analytic or the autodiff Jacobian and the Huber loss of the flags
+void BuildProblem(BALProblem *bal_problem, ceres::Problem *problem, const BundleParams &params);
+
+// false for an unknown ordering
+bool setOrdering(BALProblem *bal_problem, ceres::Solver::Options *options, const std::string &ordering_type);
+
+// everything but the tolerances, the ordering is skipped for "compare" which sets it for every run
+void setSolverOptionsFromFlags(BALProblem *bal_problem, const BundleParams &params, ceres::Solver::Options *options);
+
+#endif // BundleProblem.h
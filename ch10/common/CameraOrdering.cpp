@@ -0,0 +1,190 @@
+#include "CameraOrdering.h"
+
+#include <algorithm>
+#include <cmath>
+
+void CameraGraph(const BALProblem &problem, std::vector<std::vector<int> > *adjacency) {
+    const int num_cameras = problem.num_cameras();
+    const int num_points = problem.num_points();
+    const int num_observations = problem.num_observations();
+
+    // the points of every camera and the cameras of every point
+    std::vector<int> camera_offsets(num_cameras + 1, 0), point_offsets(num_points + 1, 0);
+    for (int i = 0; i < num_observations; ++i) {
+        camera_offsets[problem.camera_index()[i] + 1]++;
+        point_offsets[problem.point_index()[i] + 1]++;
+    }
+    for (int a = 0; a < num_cameras; ++a)
+        camera_offsets[a + 1] += camera_offsets[a];
+    for (int j = 0; j < num_points; ++j)
+        point_offsets[j + 1] += point_offsets[j];
+    std::vector<int> points(num_observations), cameras(num_observations);
+    std::vector<int> camera_fill(camera_offsets.begin(), camera_offsets.end() - 1);
+    std::vector<int> point_fill(point_offsets.begin(), point_offsets.end() - 1);
+    for (int i = 0; i < num_observations; ++i) {
+        points[camera_fill[problem.camera_index()[i]]++] = problem.point_index()[i];
+        cameras[point_fill[problem.point_index()[i]]++] = problem.camera_index()[i];
+    }
+
+    // the cameras reached through the points of each camera, seen[b] == a once b is listed for a,
+    // so every neighbor is stored once however many points the two cameras share
+    adjacency->assign(num_cameras, std::vector<int>());
+    std::vector<int> seen(num_cameras, -1);
+    for (int a = 0; a < num_cameras; ++a) {
+        std::vector<int> &neighbors = (*adjacency)[a];
+        seen[a] = a;
+        for (int k = camera_offsets[a]; k < camera_offsets[a + 1]; ++k) {
+            int j = points[k];
+            for (int l = point_offsets[j]; l < point_offsets[j + 1]; ++l) {
+                int b = cameras[l];
+                if (seen[b] != a) {
+                    seen[b] = a;
+                    neighbors.push_back(b);
+                }
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+    }
+}
+
+std::vector<int> CameraGroupsByPointCount(const BALProblem &problem) {
+    std::vector<int> counts(problem.num_cameras(), 0);
+    for (int i = 0; i < problem.num_observations(); ++i)
+        counts[problem.camera_index()[i]]++;
+
+    // bucket log2(count), then number the buckets that are used from 1
+    std::vector<int> groups(problem.num_cameras());
+    std::vector<int> buckets;
+    for (int a = 0; a < problem.num_cameras(); ++a) {
+        groups[a] = static_cast<int>(std::log2(counts[a] + 1.0));
+        buckets.push_back(groups[a]);
+    }
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+    for (int a = 0; a < problem.num_cameras(); ++a)
+        groups[a] = 1 + int(std::lower_bound(buckets.begin(), buckets.end(), groups[a]) - buckets.begin());
+    return groups;
+}
+
+namespace {
+class NestedDissection {
+public:
+    NestedDissection(const std::vector<std::vector<int> > &adjacency, int min_part_size)
+            : adjacency_(adjacency), min_part_size_(std::max(min_part_size, 1)),
+              member_(adjacency.size(), -1), level_(adjacency.size(), -1), depth_(adjacency.size(), -1),
+              stamp_(0), max_depth_(0) {}
+
+    std::vector<int> Groups() {
+        std::vector<int> all(adjacency_.size());
+        for (size_t a = 0; a < all.size(); ++a)
+            all[a] = a;
+        Dissect(all, 0);
+
+        // parts are group 1, a separator found at depth d comes after all the deeper ones
+        std::vector<int> groups(adjacency_.size());
+        for (size_t a = 0; a < groups.size(); ++a)
+            groups[a] = depth_[a] < 0 ? 1 : 2 + max_depth_ - depth_[a];
+        return groups;
+    }
+
+private:
+    // breadth first levels from start over the cameras marked with the current stamp, returns the last one reached
+    int Levels(int start, std::vector<int> *order) {
+        order->clear();
+        for (size_t k = 0; k < visited_.size(); ++k)
+            level_[visited_[k]] = -1;
+        visited_.clear();
+        level_[start] = 0;
+        visited_.push_back(start);
+        order->push_back(start);
+        for (size_t head = 0; head < order->size(); ++head) {
+            int a = (*order)[head];
+            for (size_t k = 0; k < adjacency_[a].size(); ++k) {
+                int b = adjacency_[a][k];
+                if (member_[b] == stamp_ && level_[b] < 0) {
+                    level_[b] = level_[a] + 1;
+                    visited_.push_back(b);
+                    order->push_back(b);
+                }
+            }
+        }
+        return order->back();
+    }
+
+    // the connected components of nodes are dissected one after the other, a loop rather than a recursion
+    // so that many small components cannot exhaust the stack
+    void Dissect(const std::vector<int> &nodes, int depth) {
+        if (int(nodes.size()) <= min_part_size_)
+            return;
+        const int stamp = ++stamp_;
+        for (size_t k = 0; k < nodes.size(); ++k)
+            member_[nodes[k]] = stamp;
+        std::vector<std::vector<int> > components;
+        std::vector<int> order;
+        for (size_t k = 0; k < nodes.size(); ++k) {
+            if (member_[nodes[k]] != stamp)
+                continue;
+            Levels(nodes[k], &order);
+            // out of the search for the next component
+            for (size_t l = 0; l < order.size(); ++l)
+                member_[order[l]] = -1;
+            components.push_back(order);
+        }
+        for (size_t c = 0; c < components.size(); ++c)
+            DissectConnected(components[c], depth);
+    }
+
+    void DissectConnected(const std::vector<int> &nodes, int depth) {
+        if (int(nodes.size()) <= min_part_size_)
+            return;
+        ++stamp_;
+        for (size_t k = 0; k < nodes.size(); ++k)
+            member_[nodes[k]] = stamp_;
+
+        // a pseudo-peripheral start gives long and narrow level structures
+        std::vector<int> order;
+        int far = Levels(nodes[0], &order);
+        far = Levels(far, &order);
+        const int num_levels = level_[far] + 1;
+        if (num_levels < 3)
+            return;
+
+        // separate at the level where half of the cameras have been reached
+        int split = level_[order[order.size() / 2]];
+        split = std::min(std::max(split, 1), num_levels - 2);
+        std::vector<int> first, second, separator;
+        for (size_t k = 0; k < order.size(); ++k) {
+            int a = order[k];
+            if (level_[a] < split)
+                first.push_back(a);
+            else if (level_[a] > split)
+                second.push_back(a);
+            else
+                separator.push_back(a);
+        }
+        for (size_t k = 0; k < separator.size(); ++k)
+            depth_[separator[k]] = depth;
+        max_depth_ = std::max(max_depth_, depth);
+        Dissect(first, depth + 1);
+        Dissect(second, depth + 1);
+    }
+
+    const std::vector<std::vector<int> > &adjacency_;
+    const int min_part_size_;
+    // the cameras of the part being dissected carry its stamp
+    std::vector<int> member_;
+    std::vector<int> level_;
+    std::vector<int> visited_;
+    // depth of the separator a camera belongs to, -1 for the parts
+    std::vector<int> depth_;
+    int stamp_;
+    int max_depth_;
+};
+}
+
+std::vector<int> CameraGroupsByNestedDissection(const BALProblem &problem, int min_part_size) {
+    std::vector<std::vector<int> > adjacency;
+    CameraGraph(problem, &adjacency);
+    NestedDissection dissection(adjacency, min_part_size);
+    return dissection.Groups();
+}
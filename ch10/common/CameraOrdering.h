@@ -0,0 +1,22 @@
+#ifndef CAMERAORDERING_H
+#define CAMERAORDERING_H
+
+#include <vector>
+#include "BALProblem.h"
+
+// Elimination groups of the cameras for the Schur solvers. The points always form group 0 and are
+// eliminated first; the cameras get groups from 1 on, lower groups are eliminated earlier when the
+// reduced camera system is factored, which decides its fill-in.
+
+// cameras that share at least one point, one sorted list per camera
+void CameraGraph(const BALProblem &problem, std::vector<std::vector<int> > *adjacency);
+
+// cameras observing few points first, in buckets of doubling point counts
+std::vector<int> CameraGroupsByPointCount(const BALProblem &problem);
+
+// nested dissection of the camera graph: the graph is split recursively by level set separators until the
+// parts have at most min_part_size cameras. the parts come first, then the separators from the innermost
+// to the outermost, so each separator is eliminated after both halves it separates
+std::vector<int> CameraGroupsByNestedDissection(const BALProblem &problem, int min_part_size = 16);
+
+#endif // CameraOrdering.h
@@ -1,6 +1,7 @@
 
 #include "command_args.h"
 
+#include <algorithm>
 #include <fstream>
 
 
@@ -38,5 +38,123 @@ inline bool CamProjectionWithDistortion(const T *camera, const T *point, T *pred
     return true;
 }
 
+// rotation matrix R of an angle-axis, and its left Jacobian Jl, with which the derivative of R * x is
+// -hat(R * x) * Jl. both are row-major 3x3
+inline void AngleAxisToRotationAndJacobian(const double *angle_axis, double *R, double *Jl) {
+    const double theta2 = DotProduct(angle_axis, angle_axis);
+    if (theta2 > std::numeric_limits<double>::epsilon()) {
+        const double theta = sqrt(theta2);
+        const double w[3] = {angle_axis[0] / theta, angle_axis[1] / theta, angle_axis[2] / theta};
+        const double c = cos(theta), s = sin(theta), c1 = 1.0 - c;
+        R[0] = c + w[0] * w[0] * c1;
+        R[1] = w[0] * w[1] * c1 - w[2] * s;
+        R[2] = w[0] * w[2] * c1 + w[1] * s;
+        R[3] = w[1] * w[0] * c1 + w[2] * s;
+        R[4] = c + w[1] * w[1] * c1;
+        R[5] = w[1] * w[2] * c1 - w[0] * s;
+        R[6] = w[2] * w[0] * c1 - w[1] * s;
+        R[7] = w[2] * w[1] * c1 + w[0] * s;
+        R[8] = c + w[2] * w[2] * c1;
+
+        // Jl = I + (1 - cos)/theta^2 hat(w) + (theta - sin)/theta^3 hat(w)^2
+        const double k1 = (1.0 - c) / theta2;
+        const double k2 = (theta - s) / (theta2 * theta);
+        const double *v = angle_axis;
+        const double W[9] = {0, -v[2], v[1], v[2], 0, -v[0], -v[1], v[0], 0};
+        for (int r = 0; r < 3; ++r)
+            for (int k = 0; k < 3; ++k) {
+                double W2 = W[3 * r] * W[k] + W[3 * r + 1] * W[3 + k] + W[3 * r + 2] * W[6 + k];
+                Jl[3 * r + k] = (r == k ? 1.0 : 0.0) + k1 * W[3 * r + k] + k2 * W2;
+            }
+    } else {
+        // R = I + hat(w), as AngleAxisRotatePoint does near zero, and Jl = I, which matches it
+        R[0] = 1.0;
+        R[1] = -angle_axis[2];
+        R[2] = angle_axis[1];
+        R[3] = angle_axis[2];
+        R[4] = 1.0;
+        R[5] = -angle_axis[0];
+        R[6] = -angle_axis[1];
+        R[7] = angle_axis[0];
+        R[8] = 1.0;
+        for (int k = 0; k < 9; ++k)
+            Jl[k] = k % 4 == 0 ? 1.0 : 0.0;
+    }
+}
+
+// Same projection with its analytic derivatives, for cost functions that do not use Jets.
+// jacobian_camera : 2x9 row-major d(predictions)/d(camera), may be NULL
+// jacobian_point : 2x3 row-major d(predictions)/d(point), may be NULL
+inline bool CamProjectionWithDistortionJacobian(const double *camera, const double *point, double *predictions,
+                                                double *jacobian_camera, double *jacobian_point) {
+    // q = R * point, p = q + t
+    double q[3];
+    AngleAxisRotatePoint(camera, point, q);
+    const double p[3] = {q[0] + camera[3], q[1] + camera[4], q[2] + camera[5]};
+
+    const double inv_z = 1.0 / p[2];
+    const double xp = -p[0] * inv_z;
+    const double yp = -p[1] * inv_z;
+
+    const double &focal = camera[6];
+    const double &l1 = camera[7];
+    const double &l2 = camera[8];
+    const double r2 = xp * xp + yp * yp;
+    const double distortion = 1.0 + r2 * (l1 + l2 * r2);
+
+    predictions[0] = focal * distortion * xp;
+    predictions[1] = focal * distortion * yp;
+
+    if (jacobian_camera == NULL && jacobian_point == NULL)
+        return true;
+
+    // d(predictions)/d(xp, yp)
+    const double dd_dr2 = l1 + 2.0 * l2 * r2;
+    const double a00 = focal * (distortion + 2.0 * xp * xp * dd_dr2);
+    const double a01 = focal * 2.0 * xp * yp * dd_dr2;
+    const double a11 = focal * (distortion + 2.0 * yp * yp * dd_dr2);
+
+    // d(xp, yp)/dp = [-1/z, 0, x/z^2; 0, -1/z, y/z^2], so d(predictions)/dp is
+    const double xz = -xp * inv_z, yz = -yp * inv_z;
+    const double dp[2][3] = {{-a00 * inv_z, -a01 * inv_z, a00 * xz + a01 * yz},
+                             {-a01 * inv_z, -a11 * inv_z, a01 * xz + a11 * yz}};
+
+    // dp/d(point) = R, dp/dw = -hat(q) * Jl
+    double R[9], Jl[9];
+    AngleAxisToRotationAndJacobian(camera, R, Jl);
+
+    if (jacobian_point != NULL) {
+        for (int r = 0; r < 2; ++r)
+            for (int c = 0; c < 3; ++c)
+                jacobian_point[3 * r + c] = dp[r][0] * R[c] + dp[r][1] * R[3 + c] + dp[r][2] * R[6 + c];
+    }
+
+    if (jacobian_camera != NULL) {
+        const double Q[9] = {0, -q[2], q[1], q[2], 0, -q[0], -q[1], q[0], 0};
+        double dp_dw[9];
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 3; ++c)
+                dp_dw[3 * r + c] = -(Q[3 * r] * Jl[c] + Q[3 * r + 1] * Jl[3 + c] + Q[3 * r + 2] * Jl[6 + c]);
+
+        for (int r = 0; r < 2; ++r) {
+            double *row = jacobian_camera + 9 * r;
+            // rotation
+            for (int c = 0; c < 3; ++c)
+                row[c] = dp[r][0] * dp_dw[c] + dp[r][1] * dp_dw[3 + c] + dp[r][2] * dp_dw[6 + c];
+            // translation, dp/dt = I
+            row[3] = dp[r][0];
+            row[4] = dp[r][1];
+            row[5] = dp[r][2];
+        }
+        // focal length and distortion
+        const double xy[2] = {xp, yp};
+        for (int r = 0; r < 2; ++r) {
+            jacobian_camera[9 * r + 6] = distortion * xy[r];
+            jacobian_camera[9 * r + 7] = focal * xy[r] * r2;
+            jacobian_camera[9 * r + 8] = focal * xy[r] * r2 * r2;
+        }
+    }
+    return true;
+}
 
 #endif // projection.h
\ No newline at end of file
@@ -0,0 +1,102 @@
+//
+// Created by Left Thomas on 2017/9/20.
+//
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include "common/BALProblem.h"
+#include "common/BundleParams.h"
+#include "common/BundleProblem.h"
+using namespace std;
+using namespace ceres;
+
+// 对比自动求导和解析雅可比的速度, 参数与ceres_bundle相同, 例如:
+// -input ../data/problem-16-22106-pre.txt -num_threads 4 -num_iterations 10
+
+
+struct Timing {
+    double evaluate_ms;         // one evaluation of the residuals and the Jacobian
+    double iteration_ms;        // a solver iteration
+    double jacobian_ms;         // the Jacobian evaluation share of an iteration
+    double final_cost;
+    int iterations;
+};
+
+Timing Benchmark(const BundleParams &params, bool analytic, CRSMatrix *jacobian) {
+    Timing timing;
+    const int repeats = 10;
+    BundleParams run_params = params;
+    run_params.analytic_jacobian = analytic;
+
+//    residuals and Jacobian alone, at the initial values
+    {
+        BALProblem bal_problem(params.input, false, !params.no_cache);
+        PerturbProblem(&bal_problem, run_params);
+        Problem problem;
+        BuildProblem(&bal_problem, &problem, run_params);
+        Problem::EvaluateOptions evaluate_options;
+        evaluate_options.num_threads = params.num_threads;
+        double cost;
+        vector<double> residuals;
+        problem.Evaluate(evaluate_options, &cost, &residuals, NULL, jacobian);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repeats; ++i)
+            problem.Evaluate(evaluate_options, &cost, &residuals, NULL, jacobian);
+        timing.evaluate_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeats;
+    }
+
+//    a whole solve, as ceres_bundle runs it
+    BALProblem bal_problem(params.input, false, !params.no_cache);
+    PerturbProblem(&bal_problem, run_params);
+    Problem problem;
+    BuildProblem(&bal_problem, &problem, run_params);
+    Solver::Options options;
+    setSolverOptionsFromFlags(&bal_problem, run_params, &options);
+    options.minimizer_progress_to_stdout = false;
+    options.gradient_tolerance = 1e-16;
+    options.function_tolerance = 1e-16;
+    Solver::Summary summary;
+    ceres::Solve(options, &problem, &summary);
+
+    timing.iterations = max<int>(summary.iterations.size(), 1);
+    timing.iteration_ms = 1000.0 * summary.minimizer_time_in_seconds / timing.iterations;
+    timing.jacobian_ms = 1000.0 * summary.jacobian_evaluation_time_in_seconds / timing.iterations;
+    timing.final_cost = summary.final_cost;
+    return timing;
+}
+
+int main(int argc, char **argv) {
+    BundleParams params(argc, argv);
+    if (params.input.empty()) {
+        cout << "Usage: jacobian_benchmark -input <path for dataset> [-num_threads n] [-num_iterations n]" << endl;
+        return 1;
+    }
+
+    CRSMatrix autodiff_jacobian, analytic_jacobian;
+    Timing autodiff = Benchmark(params, false, &autodiff_jacobian);
+    Timing analytic = Benchmark(params, true, &analytic_jacobian);
+
+//    both runs start from the same values, so the Jacobians have to agree entry by entry
+    double max_error = 0;
+    if (autodiff_jacobian.values.size() != analytic_jacobian.values.size()) {
+        cerr << "the two Jacobians differ in structure" << endl;
+        return 1;
+    }
+    for (size_t i = 0; i < autodiff_jacobian.values.size(); ++i) {
+        double a = autodiff_jacobian.values[i], b = analytic_jacobian.values[i];
+        max_error = max(max_error, fabs(a - b) / max(1.0, fabs(a)));
+    }
+
+    printf("%-10s %14s %14s %14s %10s %14s\n", "jacobian", "evaluate ms", "iteration ms", "jacobian ms",
+           "iterations", "final cost");
+    printf("%-10s %14.3f %14.3f %14.3f %10d %14.6e\n", "autodiff", autodiff.evaluate_ms, autodiff.iteration_ms,
+           autodiff.jacobian_ms, autodiff.iterations, autodiff.final_cost);
+    printf("%-10s %14.3f %14.3f %14.3f %10d %14.6e\n", "analytic", analytic.evaluate_ms, analytic.iteration_ms,
+           analytic.jacobian_ms, analytic.iterations, analytic.final_cost);
+    printf("speedup: %.2fx per evaluation, %.2fx per iteration\n", autodiff.evaluate_ms / analytic.evaluate_ms,
+           autodiff.iteration_ms / analytic.iteration_ms);
+    printf("max relative difference of the Jacobians: %g\n", max_error);
+    return max_error < 1e-6 ? 0 : 2;
+}
@@ -0,0 +1,60 @@
+//
+// Created by Left Thomas on 2017/9/20.
+//
+
+#include <iostream>
+#include "common/BALProblem.h"
+#include "common/BundleParams.h"
+#include "common/BundleAdjuster.h"
+using namespace std;
+
+// 不依赖ceres的舒尔补LM求解, 参数与ceres_bundle相同, 例如:
+// -input ../data/problem-16-22106-pre.txt -linear_solver sparse_schur -num_threads 4
+
+
+int main(int argc, char **argv) {
+    BundleParams params(argc, argv);
+    if (params.input.empty()) {
+        cout << "Usage: native_bundle -input <path for dataset>" << endl;
+        return 1;
+    }
+    if (params.trust_region_strategy != "levenberg_marquardt")
+        cout << "only levenberg_marquardt is implemented, ignoring " << params.trust_region_strategy << endl;
+
+    BALProblem bal_problem(params.input, false, !params.no_cache);
+    cout << "bal problem have " << bal_problem.num_cameras() << " cameras and "
+         << bal_problem.num_points() << " points. " << endl;
+    cout << "forming " << bal_problem.num_observations() << " observatoins. " << endl;
+
+    if (!params.initial_ply.empty()) {
+        bal_problem.WriteToPLYFile(params.initial_ply);
+    }
+
+    // the same noise as ceres_bundle, so both start from the same values
+    srand(static_cast<unsigned int>(params.random_seed));
+    bal_problem.Normalize();
+    bal_problem.Perturb(params.rotation_sigma, params.translation_sigma, params.point_sigma);
+
+    BundleAdjuster::Options options;
+    options.max_num_iterations = params.num_iterations;
+    options.num_threads = params.num_threads;
+    options.linear_solver = params.linear_solver;
+    options.preconditioner = params.preconditioner;
+    options.eta = params.eta;
+    options.robustify = params.robustify;
+    options.gradient_tolerance = 1e-16;
+    options.function_tolerance = 1e-16;
+
+    BundleAdjuster adjuster(&bal_problem);
+    BundleAdjuster::Summary summary;
+    if (!adjuster.Solve(options, &summary)) {
+        cerr << summary.termination << endl;
+        return 1;
+    }
+    cout << summary.FullReport() << endl;
+
+    if (!params.final_ply.empty()) {
+        bal_problem.WriteToPLYFile(params.final_ply);
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+//
+// Created by Left Thomas on 2017/9/20.
+//
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "common/BALProblem.h"
+#include "common/BALLayout.h"
+#include "common/BundleParams.h"
+#include "common/BatchProjection.h"
+#include "common/projection.h"
+using namespace std;
+
+// 投影及其解析雅可比的微基准: 逐个观测的CamProjectionWithDistortionJacobian与各个SIMD批量内核对比, 例如:
+// -input ../data/problem-16-22106-pre.txt -num_iterations 20
+
+//    the timed passes write every chunk of observations over the same few kilobytes, as BundleAdjuster does,
+//    so that they measure the arithmetic rather than the memory bandwidth of the outputs. the outputs of all
+//    observations are only kept for the comparison
+const int CHUNK = 64;
+
+struct Output {
+    vector<double> residuals, jacobian_camera, jacobian_point;
+
+    explicit Output(int num_observations)
+            : residuals(2 * num_observations), jacobian_camera(18 * num_observations),
+              jacobian_point(6 * num_observations) {}
+};
+
+//    milliseconds per pass over all observations, the best of repeats
+template<typename Function>
+double Time(int repeats, const Function &f) {
+    double best = 1e300;
+    for (int k = 0; k < repeats; ++k) {
+        auto start = chrono::steady_clock::now();
+        f();
+        best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+//    one observation at a time, as the solvers did before the batch kernels
+void ProjectOneByOne(const BALLayout &layout, bool jacobians, bool keep, Output *out) {
+    for (int i = 0; i < layout.num_observations(); ++i) {
+        const int slot = keep ? i : i % CHUNK;
+        double predictions[2];
+        CamProjectionWithDistortionJacobian(layout.camera(layout.camera_index()[i]),
+                                            layout.point(layout.point_index()[i]), predictions,
+                                            jacobians ? &out->jacobian_camera[18 * slot] : NULL,
+                                            jacobians ? &out->jacobian_point[6 * slot] : NULL);
+        out->residuals[2 * slot] = predictions[0] - layout.observed_x()[i];
+        out->residuals[2 * slot + 1] = predictions[1] - layout.observed_y()[i];
+    }
+}
+
+void ProjectBatches(const BALLayout &layout, BatchProjectionKernel kernel, bool jacobians, bool keep,
+                    Output *out) {
+    const int *offsets = layout.camera_offsets();
+    const double *points = layout.point(0);
+    for (int a = 0; a < layout.num_cameras(); ++a) {
+        double rotation[18];
+        CameraRotation(layout.camera(a), rotation);
+        for (int begin = offsets[a]; begin < offsets[a + 1]; begin += CHUNK) {
+            const int slot = keep ? begin : 0;
+            ProjectCameraObservations(kernel, layout.camera(a), rotation, points, layout.point_index() + begin,
+                                      layout.observed_x() + begin, layout.observed_y() + begin,
+                                      min(CHUNK, offsets[a + 1] - begin), &out->residuals[2 * slot],
+                                      jacobians ? &out->jacobian_camera[18 * slot] : NULL,
+                                      jacobians ? &out->jacobian_point[6 * slot] : NULL);
+        }
+    }
+}
+
+//    largest difference relative to the magnitude of the reference value
+double MaxRelativeError(const vector<double> &reference, const vector<double> &values) {
+    double error = 0;
+    for (size_t k = 0; k < reference.size(); ++k)
+        error = max(error, fabs(values[k] - reference[k]) / max(1.0, fabs(reference[k])));
+    return error;
+}
+
+int main(int argc, char **argv) {
+    BundleParams params(argc, argv);
+    if (params.input.empty()) {
+        cout << "Usage: projection_benchmark -input <path for dataset> [-num_iterations repeats]" << endl;
+        return 1;
+    }
+
+    BALProblem bal_problem(params.input, false, !params.no_cache);
+    srand(static_cast<unsigned int>(params.random_seed));
+    bal_problem.Normalize();
+    bal_problem.Perturb(params.rotation_sigma, params.translation_sigma, params.point_sigma);
+    BALLayout layout(bal_problem);
+    const int num_observations = layout.num_observations();
+    const int repeats = max(1, params.num_iterations);
+    cout << num_observations << " observations, best of " << repeats << " passes, best kernel on this CPU: "
+         << BatchProjectionKernelName(BestBatchProjectionKernel()) << endl;
+
+    Output reference(num_observations), scratch(CHUNK);
+    ProjectOneByOne(layout, true, true, &reference);
+    const double residual_ms = Time(repeats, [&]() { ProjectOneByOne(layout, false, false, &scratch); });
+    const double jacobian_ms = Time(repeats, [&]() { ProjectOneByOne(layout, true, false, &scratch); });
+
+    printf("\n%-16s %14s %10s %14s %10s %12s\n", "kernel", "residuals ms", "speedup", "jacobians ms", "speedup",
+           "max error");
+    printf("%-16s %14.3f %10.2f %14.3f %10.2f %12s\n", "one by one", residual_ms, 1.0, jacobian_ms, 1.0, "-");
+
+    const BatchProjectionKernel kernels[] = {SCALAR_KERNEL, AVX2_KERNEL, AVX512_KERNEL};
+    bool consistent = true;
+    for (BatchProjectionKernel kernel : kernels) {
+        if (!BatchProjectionKernelAvailable(kernel)) {
+            printf("%-16s %14s\n", BatchProjectionKernelName(kernel), "not available");
+            continue;
+        }
+        Output out(num_observations);
+        ProjectBatches(layout, kernel, true, true, &out);
+        const double batch_residual_ms = Time(repeats, [&]() {
+            ProjectBatches(layout, kernel, false, false, &scratch);
+        });
+        const double batch_jacobian_ms = Time(repeats, [&]() {
+            ProjectBatches(layout, kernel, true, false, &scratch);
+        });
+        const double error = max(MaxRelativeError(reference.residuals, out.residuals),
+                                 max(MaxRelativeError(reference.jacobian_camera, out.jacobian_camera),
+                                     MaxRelativeError(reference.jacobian_point, out.jacobian_point)));
+        consistent = consistent && error < 1e-8;
+        printf("%-16s %14.3f %10.2f %14.3f %10.2f %12.2e\n", BatchProjectionKernelName(kernel), batch_residual_ms,
+               residual_ms / batch_residual_ms, batch_jacobian_ms, jacobian_ms / batch_jacobian_ms, error);
+    }
+    if (!consistent) {
+        cerr << "the batch kernels disagree with CamProjectionWithDistortionJacobian" << endl;
+        return 2;
+    }
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include <fstream>
 #include "common.h"
+#include "myslam/dataset_reader.h"
 #include <string>
 
 /**
@@ -16,9 +17,9 @@ int main(int argc, char **argv) {
     }
     srand((unsigned int) time(0));
     string data_set_path = argv[1];
-    string associate_file = data_set_path + "/associate.txt";
-    ifstream fin(associate_file);
-    string rgb_file, depth_file, time_rgb, time_depth;
+//    图像在后台线程中提前解码
+    myslam::DatasetReader reader(data_set_path);
+    myslam::DatasetReader::Image image;
     cv::Mat color, depth, gray;
     vector<Measurement> measurements;
 
@@ -35,11 +36,10 @@ int main(int argc, char **argv) {
 
     cv::Mat prev_color;
     // 以第一个图像为参考，对后续图像和参考图像做直接法
-    for (int index = 0; index < 10; index++) {
+    for (int index = 0; index < 10 && reader.next(image); index++) {
         cout << "*********** loop " << index << " ************" << endl;
-        fin >> time_rgb >> rgb_file >> time_depth >> depth_file;
-        color = cv::imread(data_set_path + "/" + rgb_file);
-        depth = cv::imread(data_set_path + "/" + depth_file, -1);
+        color = image.color;
+        depth = image.depth;
         if (color.data == nullptr || depth.data == nullptr)
             continue;
         cv::cvtColor(color, gray, cv::COLOR_BGR2GRAY);
@@ -5,6 +5,7 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/features2d/features2d.hpp>
 #include <opencv2/video/tracking.hpp>
+#include "myslam/dataset_reader.h"
 
 using namespace std;
 
@@ -27,17 +28,15 @@ int main(int argc, char **argv) {
         return 1;
     }
     string data_set_path = argv[1];
-    string associate_file = data_set_path + "/associate.txt";
-    ifstream fin(associate_file);
-    string rgb_file, depth_file, time_rgb, time_depth;
+//    图像在后台线程中提前解码
+    myslam::DatasetReader reader(data_set_path);
+    myslam::DatasetReader::Image image;
 
     list<cv::Point2f> key_points;
     cv::Mat color, depth, last_color;
-//    573为associate.txt文件行数
-    for (int index = 0; index < 573; ++index) {
-        fin >> time_rgb >> rgb_file >> time_depth >> depth_file;
-        color = cv::imread(data_set_path + "/" + rgb_file);
-        depth = cv::imread(data_set_path + "/" + depth_file, -1);
+    for (int index = 0; reader.next(image); ++index) {
+        color = image.color;
+        depth = image.depth;
         if (index == 0) {
 //            对第一帧提取FAST特征点
             vector<cv::KeyPoint> kps;
@@ -0,0 +1,80 @@
+//
+// Created by Left Thomas on 2017/9/12.
+//
+
+#ifndef SLAMBOOK_BACKEND_H
+#define SLAMBOOK_BACKEND_H
+
+#include "myslam/common_include.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace myslam {
+//    sliding-window bundle adjustment problem, copied from the map on the tracking thread
+//    so the optimizer never touches the live map
+    struct BAProblem {
+        typedef shared_ptr<BAProblem> Ptr;
+
+        struct Observation {
+            int frame;
+            int point;
+            Vector2d pixel;
+        };
+
+        float fx, fy, cx, cy;
+        vector<unsigned long> keyframe_ids;
+        vector<SE3> poses;
+//        the oldest key-frame of the window is held fixed to remove the gauge freedom
+        vector<bool> fixed;
+        vector<unsigned long> point_ids;
+        vector<Vector3d> points;
+        vector<Observation> observations;
+    };
+
+//    optimized values, matched back to the map by id
+    struct BAResult {
+        typedef shared_ptr<BAResult> Ptr;
+        vector<unsigned long> keyframe_ids;
+        vector<SE3> poses;
+        vector<unsigned long> point_ids;
+        vector<Vector3d> points;
+        int iterations;
+        double initial_cost, final_cost;
+//        wall time of the optimization, in ms
+        double time;
+    };
+
+//    runs the local bundle adjustment on its own thread
+//    the tracker submits a window at every key-frame and picks up the result when it is ready,
+//    neither call waits for the optimization, a newer window replaces one that has not started yet
+    class Backend {
+    public:
+        typedef shared_ptr<Backend> Ptr;
+
+        explicit Backend(int iterations = 10);
+
+        virtual ~Backend();
+
+        void submit(const BAProblem::Ptr &problem);
+
+//        the latest result not taken yet, nullptr if there is none
+        BAResult::Ptr takeResult();
+
+//        levenberg-marquardt with the landmarks marginalized by schur complement
+        static void optimize(const BAProblem &problem, int iterations, BAResult &result);
+
+    private:
+        void run();
+
+        int iterations_;
+        bool running_;
+        BAProblem::Ptr pending_;
+        BAResult::Ptr result_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::thread thread_;
+    };
+}
+
+#endif //SLAMBOOK_BACKEND_H
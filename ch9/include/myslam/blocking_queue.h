@@ -0,0 +1,81 @@
+//
+// Created by Left Thomas on 2017/9/8.
+//
+
+#ifndef SLAMBOOK_BLOCKING_QUEUE_H
+#define SLAMBOOK_BLOCKING_QUEUE_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+namespace myslam {
+//    bounded FIFO connecting two pipeline stages
+//    push blocks while the queue is full, pop blocks while it is empty,
+//    close() wakes everybody up and makes pop drain the remaining items
+//    items live in a ring allocated once, T has to be default constructible
+    template<typename T>
+    class BlockingQueue {
+    public:
+        explicit BlockingQueue(size_t capacity) :
+                capacity_(capacity > 0 ? capacity : 1), closed_(false), head_(0), count_(0), items_(capacity_) {}
+
+        BlockingQueue(const BlockingQueue &) = delete;
+
+        BlockingQueue &operator=(const BlockingQueue &) = delete;
+
+//        return false if the queue has been closed
+        bool push(T item) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_full_.wait(lock, [this] { return closed_ || count_ < capacity_; });
+            if (closed_)
+                return false;
+            items_[(head_ + count_) % capacity_] = std::move(item);
+            count_++;
+            lock.unlock();
+            not_empty_.notify_one();
+            return true;
+        }
+
+//        return false once the queue is closed and drained
+        bool pop(T &item) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this] { return closed_ || count_ > 0; });
+            if (count_ == 0)
+                return false;
+            item = std::move(items_[head_]);
+//            do not keep what the item owns alive in the free slot
+            items_[head_] = T();
+            head_ = (head_ + 1) % capacity_;
+            count_--;
+            lock.unlock();
+            not_full_.notify_one();
+            return true;
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+            }
+            not_full_.notify_all();
+            not_empty_.notify_all();
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return count_;
+        }
+
+    private:
+        const size_t capacity_;
+        bool closed_;
+        size_t head_, count_;
+        std::vector<T> items_;
+        mutable std::mutex mutex_;
+        std::condition_variable not_full_;
+        std::condition_variable not_empty_;
+    };
+}
+
+#endif //SLAMBOOK_BLOCKING_QUEUE_H
@@ -6,8 +6,14 @@
 #define SLAMBOOK_CAMERA_H
 
 #include "myslam/common_include.h"
+#include "myslam/parameters.h"
 
 namespace myslam {
+//    points stored as structure of arrays, one point per column and each coordinate in one contiguous row,
+//    so the batch functions below run through every row with SIMD packets
+    typedef Eigen::Matrix<double, 3, Eigen::Dynamic, Eigen::RowMajor> Points3;
+    typedef Eigen::Matrix<double, 2, Eigen::Dynamic, Eigen::RowMajor> Points2;
+
 //    Pinhole RGB-D Camera model
     class Camera {
     public:
@@ -15,8 +21,11 @@ namespace myslam {
 //    Camera intrinsics
         float fx_, fy_, cx_, cy_, depth_scale_;
 
+//        intrinsics of the parameter file
         Camera();
 
+        explicit Camera(const CameraParameters &parameters);
+
         Camera(float fx_, float fy_, float cx_, float cy_, float depth_scale_) :
                 fx_(fx_), fy_(fy_), cx_(cx_), cy_(cy_), depth_scale_(depth_scale_) {}
 
@@ -33,6 +42,22 @@ namespace myslam {
 
         Vector3d pixel2world(const Vector2d &p_p, const SE3 &T_c_w, double depth = 1);
 
+//    batch versions of the above. the pose is turned into a matrix once per call.
+//    outputs must already have as many columns as the inputs and must not overlap them,
+//    column blocks of bigger buffers are accepted so callers can keep their memory between calls
+        void world2camera(const Eigen::Ref<const Points3> &p_w, const SE3 &T_c_w, Eigen::Ref<Points3> p_c) const;
+
+        void camera2world(const Eigen::Ref<const Points3> &p_c, const SE3 &T_c_w, Eigen::Ref<Points3> p_w) const;
+
+        void camera2pixel(const Eigen::Ref<const Points3> &p_c, Eigen::Ref<Points2> p_p) const;
+
+        void pixel2camera(const Eigen::Ref<const Points2> &p_p, const Eigen::Ref<const Eigen::RowVectorXd> &depth,
+                          Eigen::Ref<Points3> p_c) const;
+
+        void world2pixel(const Eigen::Ref<const Points3> &p_w, const SE3 &T_c_w, Eigen::Ref<Points2> p_p) const;
+
+        void pixel2world(const Eigen::Ref<const Points2> &p_p, const Eigen::Ref<const Eigen::RowVectorXd> &depth,
+                         const SE3 &T_c_w, Eigen::Ref<Points3> p_w) const;
     };
 
 }
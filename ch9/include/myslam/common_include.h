@@ -28,6 +28,7 @@ using cv::Mat;
 // std
 #include <vector>
 #include <list>
+#include <deque>
 #include <memory>
 #include <string>
 #include <iostream>
@@ -6,28 +6,53 @@
 #define SLAMBOOK_CONFIG_H
 
 #include "myslam/common_include.h"
+#include "myslam/parameters.h"
+#include <mutex>
 
 namespace myslam {
+//    the parameter file, read once into typed Parameters.
+//    readers get an immutable snapshot, a reload builds a new one and swaps it in, so any thread may read at any time
     class Config {
     private:
         static shared_ptr<Config> config_;
-        cv::FileStorage file_;
+        string filename_;
+//        "key=value" texts given on the command line, they win over the file
+        vector<string> overrides_;
+        Parameters::ConstPtr parameters_;
+//        text of every value parameters_ was made from
+        map<string, string> values_;
+//        serializes loading, readers never take it
+        std::mutex mutex_;
 
 //        private constructor makes it as a singleton
         Config() {};
 
+//        reads filename_ with overrides_ applied, parameters_ only changes if everything is valid
+        bool load();
+
+//        nullptr with the reason on cerr if the values are not all known and valid
+        static Parameters::ConstPtr makeParameters(map<string, string> values, const vector<string> &overrides);
+
     public:
-//        close the file when deconstructing
         virtual ~Config();
 
-//        set a new config file
-        static void setParameterFile(const string &filename);
+//        set a new config file, false if it cannot be read, has unknown keys or invalid values.
+//        then the parameters read before, or the defaults, stay in use. call it before starting other threads
+        static bool setParameterFile(const string &filename, const vector<string> &overrides = vector<string>());
+
+//        the "key=value" arguments from argv[first] on, the other arguments go to positional if given
+        static vector<string> overridesFromArgs(int argc, char **argv, int first,
+                                                vector<string> *positional = nullptr);
+
+//        read the file again, with the same overrides
+        static bool reload();
+
+//        the current parameters, they stay valid and unchanged for as long as they are held
+        static Parameters::ConstPtr parameters();
 
-//        access the parameter values
-        template<typename T>
-        static T get(const string &key) {
-            return T(Config::config_->file_[key]);
-        }
+//        the file and its command line overrides with more "key=value" overrides on top, nullptr if they are invalid.
+//        the global parameters do not change, this is how parameter sweeps get one set per run
+        static Parameters::ConstPtr derive(const vector<string> &overrides);
     };
 }
 
@@ -0,0 +1,69 @@
+//
+// Created by Left Thomas on 2017/9/16.
+//
+
+#ifndef SLAMBOOK_DATASET_READER_H
+#define SLAMBOOK_DATASET_READER_H
+
+// only OpenCV and the standard library, so the ch8 programs can use it without the rest of myslam
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace myslam {
+//    reads a TUM sequence listed in associate.txt
+//    the color and depth PNGs are decoded ahead of time by a pool of workers into a bounded ring,
+//    next() hands them out in file order, blocking only when the workers have fallen behind
+    class DatasetReader {
+    public:
+        struct Entry {
+            double color_time, depth_time;
+            std::string color_file, depth_file;
+        };
+
+//        color is 8UC3 and depth 16UC1 as in the files, ready to be put in a Frame;
+//        both are empty when the files could not be read
+        struct Image {
+            size_t index;
+            double time_stamp;
+            cv::Mat color, depth;
+        };
+
+        explicit DatasetReader(const std::string &dataset_dir, int num_workers = 2, size_t queue_size = 8);
+
+        DatasetReader(const DatasetReader &) = delete;
+
+        DatasetReader &operator=(const DatasetReader &) = delete;
+
+        virtual ~DatasetReader();
+
+//        false if associate.txt is missing
+        bool isOpened() const { return opened_; }
+
+        const std::vector<Entry> &entries() const { return entries_; }
+
+        size_t size() const { return entries_.size(); }
+
+//        the next image pair in order, false at the end of the sequence
+        bool next(Image &image);
+
+    private:
+        void decodeLoop();
+
+        bool opened_;
+        std::vector<Entry> entries_;
+        std::vector<Image> ring_;
+        std::vector<bool> ready_;
+//        next entry to decode and next entry to hand out
+        size_t next_decode_, next_out_;
+        bool stop_;
+        std::mutex mutex_;
+        std::condition_variable decoded_, consumed_;
+        std::vector<std::thread> workers_;
+    };
+}
+
+#endif //SLAMBOOK_DATASET_READER_H
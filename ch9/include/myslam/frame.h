@@ -9,6 +9,8 @@
 #include "camera.h"
 
 namespace myslam {
+class MapPoint;
+
 class Frame {
 public:
     typedef shared_ptr<Frame> Ptr;
@@ -22,6 +24,19 @@ public:
     Camera::Ptr camera_;
 //    color and depth image
     Mat color_, depth_;
+//    depth in meters as CV_32F, holes filled from the 4 neighbours and 0 where there is still none,
+//    made by prepareDepth()
+    Mat depth_map_;
+    bool has_depth_map_;
+//    ORB features, filled by the VO or ahead of time by the pipeline
+    vector<cv::KeyPoint> keypoints_;
+    Mat descriptors_;
+//    time it took to detect and describe them, in ms
+    double detect_time_, describe_time_;
+//    whether it is a key-frame
+    bool is_key_frame_;
+//    map point observed by each keypoint, only filled for key-frames
+    vector<shared_ptr<MapPoint>> map_points_;
 
     Frame();
 
@@ -33,7 +48,13 @@ public:
 //    factory function
     static Frame::Ptr createFrame();
 
-//    find the depth in depth map
+//    a new id and no content, the keypoint and descriptor buffers keep their memory
+    void recycle();
+
+//    build depth_map_ from depth_, findDepth does it if nobody did before
+    void prepareDepth();
+
+//    find the depth in depth map, -1 if there is none or the keypoint is outside the image
     double findDepth(const cv::KeyPoint &kp);
 
 //    get camera center
@@ -41,6 +62,9 @@ public:
 
 //    check if a point is in this frame
     bool isInFrame(const Vector3d &pt_world);
+
+//    whether keypoints and descriptors are already available
+    bool hasFeatures() const;
 };
 }
 
@@ -0,0 +1,35 @@
+//
+// Created by Left Thomas on 2017/9/18.
+//
+
+#ifndef SLAMBOOK_FRAME_POOL_H
+#define SLAMBOOK_FRAME_POOL_H
+
+#include "myslam/common_include.h"
+#include "myslam/frame.h"
+
+namespace myslam {
+//    recycles Frame objects together with their keypoint and descriptor buffers
+//    a frame is free again once the pool holds its only reference. a frame still in use after
+//    capacity more acquisitions is taken to be kept for good (a key-frame) and its slot gets a new frame,
+//    so the capacity should exceed the number of frames in flight. acquire() is meant for a single thread
+    class FramePool {
+    public:
+        typedef shared_ptr<FramePool> Ptr;
+
+        explicit FramePool(size_t capacity = 32);
+
+//        a frame with a new id and no content, only allocates while the pool is warming up
+        Frame::Ptr acquire();
+
+    private:
+        size_t capacity_;
+        size_t next_;
+        unsigned long acquisitions_;
+        vector<Frame::Ptr> frames_;
+//        when each frame was handed out
+        vector<unsigned long> stamps_;
+    };
+}
+
+#endif //SLAMBOOK_FRAME_POOL_H
@@ -0,0 +1,23 @@
+//
+// Created by Left Thomas on 2017/9/10.
+//
+
+#ifndef SLAMBOOK_HAMMING_KERNELS_H
+#define SLAMBOOK_HAMMING_KERNELS_H
+
+#include <cstddef>
+
+// The instruction set specific kernels of ORBMatcher, each in a source file of its own that is built with the
+// flags of its instruction set. ORBMatcher only calls them after checking the CPU at runtime.
+// These files must not include Eigen, Sophus, OpenCV or common_include.h: inline functions of those libraries
+// compiled with different flags could be merged by the linker with the ones of the rest of the library.
+
+namespace myslam {
+//    hamming distance of two 32 byte descriptors with the POPCNT instruction
+    int hammingDistancePOPCNT(const unsigned char *a, const unsigned char *b);
+
+//    distances from one 32 byte query descriptor to four train rows step bytes apart, with AVX2
+    void hammingDistance4AVX2(const unsigned char *query, const unsigned char *train, size_t step, int *out);
+}
+
+#endif //SLAMBOOK_HAMMING_KERNELS_H
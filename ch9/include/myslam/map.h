@@ -0,0 +1,31 @@
+//
+// Created by Left Thomas on 2017/9/11.
+//
+
+#ifndef SLAMBOOK_MAP_H
+#define SLAMBOOK_MAP_H
+
+#include "myslam/common_include.h"
+#include "myslam/mappoint.h"
+#include "myslam/frame.h"
+
+namespace myslam {
+//    the local map, landmarks and key-frames indexed by their id.
+//    only the key-frames of the bundle adjustment window are kept, the tracker erases them as the window slides
+    class Map {
+    public:
+        typedef shared_ptr<Map> Ptr;
+        unordered_map<unsigned long, MapPoint::Ptr> map_points_;
+        unordered_map<unsigned long, Frame::Ptr> keyframes_;
+
+        Map() = default;
+
+        void insertKeyFrame(const Frame::Ptr &frame);
+
+        void eraseKeyFrame(unsigned long id);
+
+        void insertMapPoint(const MapPoint::Ptr &map_point);
+    };
+}
+
+#endif //SLAMBOOK_MAP_H
@@ -0,0 +1,40 @@
+//
+// Created by Left Thomas on 2017/9/11.
+//
+
+#ifndef SLAMBOOK_MAPPOINT_H
+#define SLAMBOOK_MAPPOINT_H
+
+#include "myslam/common_include.h"
+
+namespace myslam {
+//    a landmark kept across frames
+    class MapPoint {
+    public:
+        typedef shared_ptr<MapPoint> Ptr;
+        unsigned long id_;
+//        whether it is still worth keeping
+        bool good_;
+//        position in world
+        Vector3d pos_;
+//        normal of viewing direction
+        Vector3d norm_;
+//        descriptor for matching
+        Mat descriptor_;
+//        times it was inside the view of a tracked frame
+        int visible_times_;
+//        times it was an inlier in pose estimation
+        int matched_times_;
+//        number of key-frames observing it
+        int observed_times_;
+
+        MapPoint();
+
+        MapPoint(unsigned long id, const Vector3d &position, const Vector3d &norm, const Mat &descriptor = Mat());
+
+//        factory function
+        static MapPoint::Ptr createMapPoint(const Vector3d &pos_world, const Vector3d &norm, const Mat &descriptor);
+    };
+}
+
+#endif //SLAMBOOK_MAPPOINT_H
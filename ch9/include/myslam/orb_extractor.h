@@ -0,0 +1,74 @@
+//
+// Created by Left Thomas on 2017/9/9.
+//
+
+#ifndef SLAMBOOK_ORB_EXTRACTOR_H
+#define SLAMBOOK_ORB_EXTRACTOR_H
+
+#include "myslam/common_include.h"
+#include <opencv2/features2d/features2d.hpp>
+
+namespace myslam {
+//    grid-bucketed ORB extractor
+//    every pyramid level is split into cells, FAST runs on all cells of all levels in parallel,
+//    each cell keeps at most its share of the level budget and the descriptors are computed
+//    on the same pyramid right after, so the image is only processed once per frame.
+//    not thread safe: every thread should own its extractor
+    class ORBExtractor {
+    public:
+        typedef shared_ptr<ORBExtractor> Ptr;
+
+        ORBExtractor(int num_features, float scale_factor, int num_levels, int cell_size = 32,
+                     int fast_threshold = 20, int min_fast_threshold = 7);
+
+//        detect keypoints and compute their descriptors, keypoints are in level 0 coordinates
+        void extract(const Mat &image, vector<cv::KeyPoint> &keypoints, Mat &descriptors);
+
+//        time spent by the last extract call in detection and in descriptors, in ms
+        double detect_time_ = 0, describe_time_ = 0;
+
+        const vector<float> &scaleFactors() const { return scale_per_level_; }
+
+    private:
+        struct Cell {
+            int level;
+            cv::Rect roi;
+        };
+
+        void computePyramid(const Mat &gray);
+
+        void detectInCell(int index);
+
+        void describeLevel(int level);
+
+        float computeAngle(const Mat &image, const cv::Point2f &pt) const;
+
+        int num_features_;
+        int num_levels_;
+        int cell_size_;
+        int fast_threshold_;
+        int min_fast_threshold_;
+
+        vector<float> scale_per_level_;
+        vector<int> features_per_level_;
+//        half width of each row of the orientation patch
+        vector<int> umax_;
+//        single level ORB used to compute rBRIEF descriptors on each pyramid level
+        vector<cv::Ptr<cv::ORB>> describers_;
+
+//        per frame buffers, kept to reuse their memory
+        Mat gray_;
+        vector<Mat> pyramid_;
+        vector<Cell> cells_;
+        vector<int> cells_per_level_;
+        vector<vector<cv::KeyPoint>> cell_keypoints_;
+        vector<vector<cv::KeyPoint>> cell_spare_;
+        vector<vector<cv::KeyPoint>> level_keypoints_;
+        vector<cv::KeyPoint> spare_;
+        vector<Mat> level_descriptors_;
+
+        friend class ExtractorBody;
+    };
+}
+
+#endif //SLAMBOOK_ORB_EXTRACTOR_H
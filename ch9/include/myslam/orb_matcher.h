@@ -0,0 +1,41 @@
+//
+// Created by Left Thomas on 2017/9/10.
+//
+
+#ifndef SLAMBOOK_ORB_MATCHER_H
+#define SLAMBOOK_ORB_MATCHER_H
+
+#include "myslam/common_include.h"
+
+namespace myslam {
+//    hamming matcher for 256 bit ORB descriptors (32 bytes per row)
+//    distances are computed with AVX2 or POPCNT when the CPU has them, checked at runtime
+    class ORBMatcher {
+    public:
+        typedef shared_ptr<ORBMatcher> Ptr;
+
+        static const int DESCRIPTOR_BYTES = 32;
+
+//        hamming distance between two descriptors
+        static int distance(const uchar *a, const uchar *b);
+
+//        best train descriptor for every query descriptor, same output as cv::BFMatcher::match
+        void match(const Mat &query, const Mat &train, vector<cv::DMatch> &matches);
+
+//        guided matching: query i is only compared with the train keypoints within radius of predicted[i],
+//        queries predicted outside the image (negative coordinates) are skipped
+        void matchInWindow(const Mat &query, const vector<cv::Point2f> &predicted,
+                           const vector<cv::KeyPoint> &train_keypoints, const Mat &train, float radius,
+                           vector<cv::DMatch> &matches);
+
+    private:
+//        index of the train keypoints in square cells of the window size
+        void buildGrid(const vector<cv::KeyPoint> &keypoints, float cell_size);
+
+        float cell_size_ = 0;
+        int grid_cols_ = 0, grid_rows_ = 0;
+        vector<vector<int>> grid_;
+    };
+}
+
+#endif //SLAMBOOK_ORB_MATCHER_H
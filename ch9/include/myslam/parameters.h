@@ -0,0 +1,67 @@
+//
+// Created by Left Thomas on 2017/9/19.
+//
+
+#ifndef SLAMBOOK_PARAMETERS_H
+#define SLAMBOOK_PARAMETERS_H
+
+#include "myslam/common_include.h"
+
+namespace myslam {
+//    every parameter of the yaml file as a typed value, parsed once by Config.
+//    the defaults are those of config/default.yaml, keys missing from a file keep them
+
+    struct CameraParameters {
+        float fx = 517.3f, fy = 516.5f, cx = 325.1f, cy = 249.7f;
+        float depth_scale = 5000;
+    };
+
+    struct VOParameters {
+        int number_of_features = 500;
+        float scale_factor = 1.2f;
+        int level_pyramid = 8;
+        int cell_size = 32;
+        int fast_threshold = 20;
+        int min_fast_threshold = 7;
+        float match_ratio = 2.0f;
+        float match_window = 40;
+        int max_num_lost = 10;
+        int min_inliers = 10;
+        int pnp_iterations = 100;
+        double pnp_confidence = 0.99;
+        int pose_refine_iterations = 10;
+        double map_point_erase_ratio = 0.1;
+        int min_map_matches = 100;
+        int max_map_points = 1000;
+        double keyframe_rotation = 0.1;
+        double keyframe_translation = 0.1;
+        int ba_window_size = 5;
+        int ba_iterations = 10;
+        string vocabulary_file;
+        int reloc_candidates = 5;
+        int reloc_max_lost_frames = 300;
+    };
+
+    struct Parameters {
+        typedef shared_ptr<const Parameters> ConstPtr;
+
+        string dataset_dir;
+        string dataset_pack;
+        int decode_threads = 2;
+        int decode_queue_size = 8;
+        CameraParameters camera;
+        VOParameters vo;
+        string profile_csv = "vo_profile.csv";
+        string profile_json = "vo_profile.json";
+        double benchmark_min_fps = 0;
+        double benchmark_max_ate = 0;
+
+//        fills the parameters from yaml key -> value text, unknown keys are errors
+        bool parse(const map<string, string> &values, ostream &errors);
+
+//        false with one line per invalid value
+        bool validate(ostream &errors) const;
+    };
+}
+
+#endif //SLAMBOOK_PARAMETERS_H
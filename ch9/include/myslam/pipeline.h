@@ -0,0 +1,94 @@
+//
+// Created by Left Thomas on 2017/9/8.
+//
+
+#ifndef SLAMBOOK_PIPELINE_H
+#define SLAMBOOK_PIPELINE_H
+
+#include "myslam/common_include.h"
+#include "myslam/blocking_queue.h"
+#include "myslam/visual_odometry.h"
+#include "myslam/frame_pool.h"
+#include <thread>
+#include <atomic>
+
+namespace myslam {
+//    multi-stage front end: decode -> feature extraction -> tracking
+//    every stage runs on its own thread(s) and the stages are connected by bounded queues,
+//    so frame N+1 is decoded and featurized while frame N is matched and solved.
+//    matching and PnP stay in one stage since both depend on the reference set by the previous frame.
+    class Pipeline {
+    public:
+        typedef shared_ptr<Pipeline> Ptr;
+
+//        what comes out of the pipeline, always in input order
+        struct Result {
+            Frame::Ptr frame;
+//            return value of VisualOdometry::addFrame
+            bool tracked;
+//            VO state after this frame
+            VisualOdometry::VOState state;
+//            time spent in the tracking stage, in ms
+            double track_time;
+//            breakdown of the tracking stage
+            Profiler::FrameRecord timing;
+        };
+
+        Pipeline(const VisualOdometry::Ptr &vo, const Camera::Ptr &camera, size_t queue_size = 4,
+                 int num_extractors = 2);
+
+        virtual ~Pipeline();
+
+//        feed an image pair to be decoded, blocks while the decode queue is full
+        bool push(double time_stamp, const string &color_file, const string &depth_file);
+
+//        feed a frame that is already decoded
+        bool push(const Frame::Ptr &frame);
+
+//        no more input, the stages drain and stop. also wakes up a blocked push
+        void finish();
+
+//        next result in input order, returns false when everything has been delivered
+        bool pop(Result &result);
+
+    private:
+        struct Input {
+            double time_stamp;
+            string color_file, depth_file;
+            Frame::Ptr frame;
+        };
+
+        struct Job {
+            unsigned long seq;
+            Frame::Ptr frame;
+        };
+
+        void decodeLoop();
+
+        void extractLoop();
+
+        void trackLoop();
+
+//        run the VO on one frame and hand the result out, false if the pipeline is shutting down
+        bool track(const Frame::Ptr &frame);
+
+        VisualOdometry::Ptr vo_;
+        Camera::Ptr camera_;
+//        frames for decoded files, only used by the decode thread
+        FramePool frame_pool_;
+
+        BlockingQueue<Input> input_queue_;
+        BlockingQueue<Job> extract_queue_;
+        BlockingQueue<Job> track_queue_;
+        BlockingQueue<Result> result_queue_;
+
+//        extractors still running, the last one closes the tracking queue
+        std::atomic<int> running_extractors_;
+
+        std::thread decode_thread_;
+        vector<std::thread> extract_threads_;
+        std::thread track_thread_;
+    };
+}
+
+#endif //SLAMBOOK_PIPELINE_H
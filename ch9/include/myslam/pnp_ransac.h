@@ -0,0 +1,60 @@
+//
+// Created by Left Thomas on 2017/9/13.
+//
+
+#ifndef SLAMBOOK_PNP_RANSAC_H
+#define SLAMBOOK_PNP_RANSAC_H
+
+#include "myslam/common_include.h"
+#include "myslam/camera.h"
+#include <random>
+
+namespace myslam {
+//    PnP RANSAC with an adaptive number of iterations
+//    the iteration count follows the best inlier ratio found so far, hypotheses are verified with
+//    the sequential probability ratio test (SPRT) and dropped as soon as they look bad,
+//    and a predicted pose can be tested before any random sample is drawn
+    class PnPRansac {
+    public:
+        typedef shared_ptr<PnPRansac> Ptr;
+
+        PnPRansac(int max_iterations = 100, double threshold = 4.0, double confidence = 0.99);
+
+//        returns the number of inliers, T_c_w and inliers are only valid if it is not 0
+//        prior is the predicted pose, nullptr if there is none
+        int estimate(const vector<Vector3d> &pts_3d, const vector<Vector2d> &pts_2d, const Camera::Ptr &camera,
+                     const SE3 *prior, SE3 &T_c_w, vector<int> &inliers);
+
+//        statistics of the last call
+        int iterations_;
+        int rejected_;
+
+    private:
+//        SPRT decision threshold for the current inlier ratio estimate
+        void updateSPRT(double inlier_ratio);
+
+//        full count of the inliers of a hypothesis
+        int countInliers(const SE3 &T_c_w, vector<int> *inliers) const;
+
+//        SPRT verification, false as soon as the hypothesis is rejected
+        bool verify(const SE3 &T_c_w, int &num_inliers);
+
+        int max_iterations_;
+        double threshold2_;
+        double confidence_;
+//        probability that a point agrees with a wrong model, and the current inlier ratio estimate
+        double delta_, epsilon_;
+        double decision_threshold_;
+
+        const vector<Vector3d> *pts_3d_;
+        const vector<Vector2d> *pts_2d_;
+        double fx_, fy_, cx_, cy_;
+        std::mt19937 rng_;
+//        kept between calls so solving a frame does not allocate them again
+        vector<cv::Point3f> sample_3d_;
+        vector<cv::Point2f> sample_2d_;
+        Mat rvec_, tvec_;
+    };
+}
+
+#endif //SLAMBOOK_PNP_RANSAC_H
@@ -0,0 +1,80 @@
+//
+// Created by Left Thomas on 2017/9/19.
+//
+
+#ifndef SLAMBOOK_POSE_PUBLISHER_H
+#define SLAMBOOK_POSE_PUBLISHER_H
+
+#include "myslam/common_include.h"
+#include <atomic>
+#include <cstdint>
+
+namespace myslam {
+//    what the VO tells the outside world about every frame it was given
+    struct PoseUpdate {
+        unsigned long frame_id;
+        double time_stamp;
+//        T_c_w as translation and unit quaternion x y z w, plain numbers so an update can be copied word by word
+        double translation[3];
+        double rotation[4];
+//        VisualOdometry::VOState after the frame
+        int32_t state;
+//        return value of addFrame
+        int32_t tracked;
+        int32_t num_inliers;
+        int32_t num_map_points;
+//        whole addFrame call, in ms
+        double track_time;
+
+        SE3 pose() const;
+
+        void setPose(const SE3 &T_c_w);
+    };
+
+//    single producer, any number of consumers, nobody ever waits on anybody.
+//    updates go to a ring of slots, each guarded by a sequence lock: the writer makes the slot's
+//    sequence odd while it writes, a reader copies the slot and keeps the copy only if the sequence
+//    was even and unchanged around it. a consumer that falls a whole ring behind loses the oldest updates
+    class PosePublisher {
+    public:
+        typedef shared_ptr<PosePublisher> Ptr;
+
+//        at least 2 slots
+        explicit PosePublisher(size_t capacity = 1024);
+
+        PosePublisher(const PosePublisher &) = delete;
+
+        PosePublisher &operator=(const PosePublisher &) = delete;
+
+//        only to be called from one thread
+        void publish(const PoseUpdate &update);
+
+//        number of updates published so far
+        unsigned long published() const { return published_.load(std::memory_order_acquire); }
+
+//        the newest update, false if there is none yet
+        bool latest(PoseUpdate &update) const;
+
+//        in order reading: the update number cursor, or the oldest one still in the ring if it was overwritten.
+//        cursor moves past what was returned, false when there is nothing new
+        bool next(unsigned long &cursor, PoseUpdate &update) const;
+
+    private:
+        static const size_t WORDS = (sizeof(PoseUpdate) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        struct Slot {
+//            2n+1 while update n is written, 2n+2 once it is complete
+            std::atomic<unsigned long> sequence;
+            std::atomic<uint64_t> words[WORDS];
+        };
+
+//        copy of update n, false if the slot does not hold it (not yet written, being written or overwritten)
+        bool read(unsigned long n, PoseUpdate &update) const;
+
+        const size_t capacity_;
+        unique_ptr<Slot[]> slots_;
+        std::atomic<unsigned long> published_;
+    };
+}
+
+#endif //SLAMBOOK_POSE_PUBLISHER_H
@@ -0,0 +1,97 @@
+//
+// Created by Left Thomas on 2017/9/14.
+//
+
+#ifndef SLAMBOOK_PROFILER_H
+#define SLAMBOOK_PROFILER_H
+
+#include "myslam/common_include.h"
+#include <chrono>
+
+namespace myslam {
+//    per-frame latency of the VO stages
+//    stages are a fixed enum so a measurement is two clock reads and an add, no lookup or allocation
+//    besides one record per frame; it is not thread safe, only the tracking thread writes to it
+    class Profiler {
+    public:
+        typedef shared_ptr<Profiler> Ptr;
+
+        enum Stage {
+//            the whole addFrame call
+            TOTAL = 0,
+//            feature detection and descriptors, measured wherever the features were extracted
+            DETECT,
+            DESCRIBE,
+//            writing back the local bundle adjustment result
+            BA_UPDATE,
+            MATCH,
+            PNP,
+            REFINE,
+            CHECK,
+//            map point culling
+            MAP,
+//            key-frame insertion, new map points and the submission to the backend
+            KEYFRAME,
+//            bag-of-words query and PnP against the candidates while lost
+            RELOCALIZE,
+            NUM_STAGES
+        };
+
+        struct FrameRecord {
+            unsigned long id;
+//            in ms, 0 for the stages the frame did not go through
+            double time[NUM_STAGES];
+        };
+
+//        adds the elapsed time to a stage of the current frame when it goes out of scope
+        class ScopedTimer {
+        public:
+            ScopedTimer(Profiler &profiler, Stage stage) : profiler_(profiler), stage_(stage),
+                                                           start_(std::chrono::steady_clock::now()) {}
+
+            ~ScopedTimer() {
+                auto end = std::chrono::steady_clock::now();
+                profiler_.record(stage_, std::chrono::duration<double, std::milli>(end - start_).count());
+            }
+
+        private:
+            Profiler &profiler_;
+            Stage stage_;
+            std::chrono::steady_clock::time_point start_;
+        };
+
+//        records for expected_frames frames are reserved up front, so a normal run records without allocating
+        explicit Profiler(size_t expected_frames = 8192) { records_.reserve(expected_frames); }
+
+        static const char *stageName(Stage stage);
+
+//        start the record of a new frame, later measurements go to it
+        void beginFrame(unsigned long id);
+
+        void record(Stage stage, double ms) {
+            if (!records_.empty())
+                records_.back().time[stage] += ms;
+        }
+
+        const vector<FrameRecord> &records() const { return records_; }
+
+//        p in [0, 100], over the frames that went through the stage
+        double percentile(Stage stage, double p) const;
+
+//        count, mean, p50, p95, p99 and max of every stage
+        void printSummary(ostream &out) const;
+
+//        one row per frame, one column per stage
+        bool writeCSV(const string &filename) const;
+
+//        the per-frame records and the summary
+        bool writeJSON(const string &filename) const;
+
+    private:
+        vector<double> samples(Stage stage) const;
+
+        vector<FrameRecord> records_;
+    };
+}
+
+#endif //SLAMBOOK_PROFILER_H
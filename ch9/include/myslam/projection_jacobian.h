@@ -0,0 +1,48 @@
+//
+// Created by Left Thomas on 2017/9/12.
+//
+
+#ifndef SLAMBOOK_PROJECTION_JACOBIAN_H
+#define SLAMBOOK_PROJECTION_JACOBIAN_H
+
+#include "myslam/common_include.h"
+
+namespace myslam {
+//    closed-form jacobians of the pinhole projection u = fx * x / z + cx, v = fy * y / z + cy
+//    of a point p_c = T_c_w * p_w, same derivation as EdgeSE3ProjectDirect in ch8
+
+//    with respect to a left perturbation exp(delta) * T_c_w, delta = [translation, rotation] as in SE3::log
+    inline Eigen::Matrix<double, 2, 6> jacobianPixelToPose(const Vector3d &p_c, double fx, double fy) {
+        double x = p_c(0, 0), y = p_c(1, 0);
+        double invz = 1.0 / p_c(2, 0);
+        double invz_2 = invz * invz;
+        Eigen::Matrix<double, 2, 6> J;
+        J(0, 0) = fx * invz;
+        J(0, 1) = 0;
+        J(0, 2) = -fx * x * invz_2;
+        J(0, 3) = -fx * x * y * invz_2;
+        J(0, 4) = fx + fx * x * x * invz_2;
+        J(0, 5) = -fx * y * invz;
+
+        J(1, 0) = 0;
+        J(1, 1) = fy * invz;
+        J(1, 2) = -fy * y * invz_2;
+        J(1, 3) = -fy - fy * y * y * invz_2;
+        J(1, 4) = fy * x * y * invz_2;
+        J(1, 5) = fy * x * invz;
+        return J;
+    }
+
+//    with respect to the point in camera frame, multiply by R_c_w for the world point
+    inline Eigen::Matrix<double, 2, 3> jacobianPixelToPoint(const Vector3d &p_c, double fx, double fy) {
+        double x = p_c(0, 0), y = p_c(1, 0);
+        double invz = 1.0 / p_c(2, 0);
+        double invz_2 = invz * invz;
+        Eigen::Matrix<double, 2, 3> J;
+        J << fx * invz, 0, -fx * x * invz_2,
+                0, fy * invz, -fy * y * invz_2;
+        return J;
+    }
+}
+
+#endif //SLAMBOOK_PROJECTION_JACOBIAN_H
@@ -0,0 +1,61 @@
+//
+// Created by Left Thomas on 2017/9/19.
+//
+
+#ifndef SLAMBOOK_RELOCALIZER_H
+#define SLAMBOOK_RELOCALIZER_H
+
+#include "myslam/common_include.h"
+#include "myslam/frame.h"
+#include "myslam/mappoint.h"
+#include "myslam/orb_matcher.h"
+#include "myslam/pnp_ransac.h"
+
+namespace myslam {
+//    recovers the pose of a frame the VO lost track of.
+//    every key-frame goes into a DBoW3 database, the most similar ones are the candidates,
+//    their map points are matched to the frame and the first candidate PnP agrees with wins.
+//    the database keeps an inverted index, so a query only visits the key-frames sharing words with the frame
+    class Relocalizer {
+    public:
+        typedef shared_ptr<Relocalizer> Ptr;
+
+        Relocalizer(const string &vocabulary_file, int num_candidates = 5, int min_inliers = 10);
+
+        virtual ~Relocalizer();
+
+//        false if the vocabulary cannot be read or myslam was built without DBoW3
+        bool isReady() const;
+
+//        only the descriptors of the keypoints with a map point are kept, not the images
+        void addKeyFrame(const Frame::Ptr &frame);
+
+        size_t size() const { return keyframes_.size(); }
+
+//        on success T_c_w is the pose of frame, points and keypoint_index are the inlier matches
+        bool relocalize(const Frame::Ptr &frame, PnPRansac &pnp, SE3 &T_c_w,
+                        vector<MapPoint::Ptr> &points, vector<int> &keypoint_index);
+
+    private:
+        struct KeyFrameEntry {
+            unsigned long frame_id;
+            Mat descriptors;
+            vector<MapPoint::Ptr> points;
+        };
+
+//        DBoW3 vocabulary and database, only known to relocalizer.cpp
+        struct Index;
+        unique_ptr<Index> index_;
+        int num_candidates_;
+        int min_inliers_;
+//        by database entry id
+        vector<KeyFrameEntry> keyframes_;
+        ORBMatcher matcher_;
+        vector<cv::DMatch> matches_;
+        vector<Vector3d> pts_3d_;
+        vector<Vector2d> pts_2d_;
+        vector<int> inliers_;
+    };
+}
+
+#endif //SLAMBOOK_RELOCALIZER_H
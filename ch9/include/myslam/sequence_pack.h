@@ -0,0 +1,84 @@
+//
+// Created by Left Thomas on 2017/9/17.
+//
+
+#ifndef SLAMBOOK_SEQUENCE_PACK_H
+#define SLAMBOOK_SEQUENCE_PACK_H
+
+#include "myslam/common_include.h"
+#include <cstdint>
+#include <cstdio>
+
+namespace myslam {
+//    an RGB-D sequence packed in one file, replayed without decoding anything
+//
+//    layout: a header, the raw pixels of every frame, then an index of PackEntry records.
+//    pixel blocks start on 64 byte boundaries and their rows are contiguous, so a mapped frame
+//    can be wrapped in a cv::Mat header directly
+
+    struct PackEntry {
+        double time_stamp;
+        int32_t width, height;
+//        file offsets of the BGR 8UC3 and the 16UC1 depth pixels
+        uint64_t color_offset, depth_offset;
+//        groundtruth camera pose tx ty tz qx qy qz qw as in TUM files, valid if has_pose is not 0
+        int32_t has_pose;
+        int32_t reserved;
+        double pose[7];
+    };
+
+    class SequencePackWriter {
+    public:
+        typedef shared_ptr<SequencePackWriter> Ptr;
+
+        SequencePackWriter() = default;
+
+        virtual ~SequencePackWriter();
+
+        bool open(const string &filename);
+
+//        color must be 8UC3 and depth 16UC1 of the same size, pose is nullptr when there is no groundtruth
+        bool add(double time_stamp, const Mat &color, const Mat &depth, const double *pose = nullptr);
+
+//        writes the index, the file is not readable before this
+        bool close();
+
+    private:
+        bool writeBlock(const Mat &image, uint64_t &offset);
+
+        FILE *file_ = nullptr;
+        uint64_t offset_ = 0;
+        vector<PackEntry> entries_;
+    };
+
+//    read-only view of a pack file through a private memory mapping
+//    the Mats it returns point into the mapping: they stay valid only as long as the SequencePack
+//    and writing to them only touches a private copy of the page
+    class SequencePack {
+    public:
+        typedef shared_ptr<SequencePack> Ptr;
+
+//        nullptr if the file is missing or not a pack
+        static SequencePack::Ptr open(const string &filename);
+
+        virtual ~SequencePack();
+
+        size_t size() const { return num_frames_; }
+
+        const PackEntry &entry(size_t i) const { return entries_[i]; }
+
+        Mat color(size_t i) const;
+
+        Mat depth(size_t i) const;
+
+    private:
+        SequencePack() = default;
+
+        uchar *data_ = nullptr;
+        size_t length_ = 0;
+        size_t num_frames_ = 0;
+        const PackEntry *entries_ = nullptr;
+    };
+}
+
+#endif //SLAMBOOK_SEQUENCE_PACK_H
@@ -0,0 +1,44 @@
+//
+// Created by Left Thomas on 2017/9/21.
+//
+
+#ifndef SLAMBOOK_TRACKING_MONITOR_H
+#define SLAMBOOK_TRACKING_MONITOR_H
+
+#include "myslam/common_include.h"
+#include "myslam/visual_odometry.h"
+
+namespace myslam {
+//    follows the VO state frame by frame for the programs feeding it. a LOST VO only relocalizes on the frames
+//    it is given afterwards, so frames keep coming while LOST as long as there is a relocalizer,
+//    until more than max_lost_frames frames in a row were lost
+    class TrackingMonitor {
+    public:
+        TrackingMonitor(bool can_relocalize, int max_lost_frames) :
+                can_relocalize_(can_relocalize), max_lost_frames_(max_lost_frames) {}
+
+//        state of the VO after frame_id, false once feeding more frames is pointless
+        bool update(unsigned long frame_id, VisualOdometry::VOState state);
+
+//        the programs stopped because the VO was lost for good
+        bool gaveUp() const { return gave_up_; }
+
+        int lostFrames() const { return lost_frames_; }
+
+//        ids of the frames the VO came back on
+        const vector<unsigned long> &relocalized() const { return relocalized_; }
+
+        void printSummary(ostream &out) const;
+
+    private:
+        bool can_relocalize_;
+        int max_lost_frames_;
+        bool was_lost_ = false;
+        bool gave_up_ = false;
+        int lost_frames_ = 0;
+        int lost_in_a_row_ = 0;
+        vector<unsigned long> relocalized_;
+    };
+}
+
+#endif //SLAMBOOK_TRACKING_MONITOR_H
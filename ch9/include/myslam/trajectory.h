@@ -0,0 +1,42 @@
+//
+// Created by Left Thomas on 2017/9/15.
+//
+
+#ifndef SLAMBOOK_TRAJECTORY_H
+#define SLAMBOOK_TRAJECTORY_H
+
+#include "myslam/common_include.h"
+
+namespace myslam {
+//    camera trajectories in the TUM format "timestamp tx ty tz qx qy qz qw" and their errors
+    struct StampedPose {
+        double time;
+//        transform from camera to world, the camera pose
+        SE3 T_w_c;
+    };
+
+    typedef vector<StampedPose> Trajectory;
+
+//    translation and rotation errors, rotation in rad
+    struct TrajectoryError {
+        int pairs = 0;
+        double rmse = 0, mean = 0, median = 0, max_error = 0;
+        double rot_rmse = 0;
+    };
+
+    bool readTUMTrajectory(const string &filename, Trajectory &trajectory);
+
+    bool writeTUMTrajectory(const string &filename, const Trajectory &trajectory);
+
+//    pairs of poses whose time stamps differ by less than max_difference, both trajectories sorted by time
+    void associateTrajectories(const Trajectory &estimated, const Trajectory &groundtruth, double max_difference,
+                               Trajectory &matched_estimated, Trajectory &matched_groundtruth);
+
+//    absolute trajectory error after a rigid alignment of the positions (Umeyama, no scale for RGB-D)
+    TrajectoryError computeATE(const Trajectory &estimated, const Trajectory &groundtruth);
+
+//    relative pose error of the motion between pose i and pose i + delta
+    TrajectoryError computeRPE(const Trajectory &estimated, const Trajectory &groundtruth, int delta = 1);
+}
+
+#endif //SLAMBOOK_TRAJECTORY_H
@@ -7,7 +7,15 @@
 
 #include "myslam/common_include.h"
 #include "myslam/frame.h"
-#include <opencv2/features2d/features2d.hpp>
+#include "myslam/map.h"
+#include "myslam/backend.h"
+#include "myslam/orb_extractor.h"
+#include "myslam/orb_matcher.h"
+#include "myslam/pnp_ransac.h"
+#include "myslam/profiler.h"
+#include "myslam/relocalizer.h"
+#include "myslam/pose_publisher.h"
+#include "myslam/parameters.h"
 
 namespace myslam {
     class VisualOdometry {
@@ -20,53 +28,154 @@ namespace myslam {
         };
 //        current VO status
         VOState state_;
+//        local map of persistent landmarks
+        Map::Ptr map_;
+//        last tracked frame, the motion prior is relative to it
         Frame::Ptr ref_;
         Frame::Ptr curr_;
-//        orb detector and computer
-        cv::Ptr<cv::ORB> orb_;
-//        3d points in reference frame
-        vector<cv::Point3f> pts_3d_ref_;
-        vector<cv::KeyPoint> keypoints_curr_;
-        Mat descriptors_curr_;
-        Mat descriptors_ref_;
-        vector<cv::DMatch> features_matches_;
+//        the newest key-frames, optimized by the backend
+        deque<Frame::Ptr> local_keyframes_;
+//        local bundle adjustment thread
+        Backend::Ptr backend_;
+//        grid-bucketed orb detector and computer
+        ORBExtractor::Ptr extractor_;
+//        hamming matcher, reused across frames
+        ORBMatcher matcher_;
+//        adaptive PnP RANSAC
+        PnPRansac::Ptr pnp_;
+//        bag-of-words key-frame index used while LOST, nullptr without a vocabulary
+        Relocalizer::Ptr relocalizer_;
+//        matched map points and the index of the keypoint each one was matched to
+        vector<MapPoint::Ptr> match_3dpts_;
+        vector<int> match_2dkp_index_;
+//        per frame buffers of matching and PnP, members so their memory is reused
+        vector<MapPoint::Ptr> candidates_;
+        vector<cv::Point2f> predicted_;
+        Mat candidate_descriptors_;
+        vector<cv::DMatch> matches_;
+        vector<Vector3d> pnp_points_;
+        vector<Vector2d> pnp_pixels_;
+        vector<int> pnp_inliers_;
+//        the map projected in one batch
+        Points3 map_positions_, map_cameras_;
+        Points2 map_pixels_;
+        vector<int> new_point_indices_;
+//        which matches are in front of the camera during the pose refinement
+        vector<char> refine_in_front_, refine_in_front_new_;
 
+        SE3 T_c_w_estimated_;
+//        motion of the current frame relative to the reference frame
         SE3 T_c_r_estimated_;
+//        whether T_c_r_estimated_ of the last frame can predict the motion of the next one
+        bool has_motion_prior_;
         int num_inliers_;
         int num_lost_;
+//        latency of every stage of every frame
+        Profiler::Ptr profiler_;
+//        pose, state and statistics after every frame, for readers on other threads
+        PosePublisher::Ptr publisher_;
+//        handed over by updateParameters, nullptr when there is nothing new
+        shared_ptr<const VOParameters> pending_parameters_;
 
 //        paramters;
         int num_of_features_;
 //        scale in image pyramid
         float scale_factor_;
         int level_pyramid_;
+//        size of the feature grid cells and the FAST thresholds used in them
+        int cell_size_;
+        int fast_threshold_;
+        int min_fast_threshold_;
 //        ratio for selecting good matches
         float match_ratio_;
+//        radius in pixels of the search window around the predicted projection
+        float match_window_;
 //        max number of continuous lost frames
         int max_num_lost_;
         int min_inliers_;
+//        RANSAC only has to find the inliers, the refinement fixes the pose,
+//        the iterations stop early once the inlier ratio reaches the confidence, this is only the upper bound
+        int pnp_iterations_;
+        double pnp_confidence_;
+//        gauss-newton iterations of the pose-only refinement
+        int pose_refine_iterations_;
+//        map points matched in fewer than this ratio of the frames they were visible in are removed
+        double map_point_erase_ratio_;
+//        new map points are created from the current frame when fewer points were matched
+        int min_map_matches_;
+//        the erase ratio is doubled while the map holds more points than this
+        int max_map_points_;
+//        minimal rotation and translation from the last key-frame to insert a new one
+        double key_frame_min_rot_;
+        double key_frame_min_trans_;
+//        number of key-frames in the bundle adjustment window and iterations spent on it
+        int ba_window_size_;
+        int ba_iterations_;
+//        DBoW3 vocabulary for relocalization and how many similar key-frames are tried
+        string vocabulary_file_;
+        int reloc_candidates_;
 
 //        functions
+//        with the parameters of the parameter file
         VisualOdometry();
 
+        explicit VisualOdometry(const VOParameters &parameters);
+
         virtual ~VisualOdometry();
 
-//        add a new frame
+//        add a new frame, features are extracted here unless the frame already has them.
+//        the outcome is published to publisher_ before it returns
         bool addFrame(Frame::Ptr frame);
 
+//        may be called from any thread, takes effect at the next addFrame. only the matching, PnP, map and
+//        key-frame thresholds change, the extractor, the backend and the relocalizer keep their setup
+        void updateParameters(const VOParameters &parameters);
+
+//        an extractor with the same parameters, for extracting features on other threads
+        ORBExtractor::Ptr createExtractor() const;
+
     protected:
+//        the parameters updateParameters can change
+        void applyParameters(const VOParameters &parameters);
+
+//        state machine of addFrame, false if the frame was not tracked
+        bool trackFrame(const Frame::Ptr &frame);
+
+        void publish(const Frame::Ptr &frame, bool tracked);
+
 //        inner operation
+//        keypoints and descriptors in one pass
         void extractKeyPoints();
 
-        void computeDescriptors();
-
         void featuresMatching();
 
         void poseEstimationPnP();
 
-        void setRef3DPoints();
+//        gauss-newton on the reprojection error of the inliers, with the pose of RANSAC as initial value
+        void poseRefinement();
+
+//        cull bad map points
+        void optimizeMap();
+
+        void addMapPoints();
+
+//        enough motion or too few matched map points
+        bool checkKeyFrame();
+
+        void addKeyFrame();
+
+//        hand the key-frame window to the backend
+        void submitLocalBA();
+
+//        write back the latest backend result, if there is one
+        void applyLocalBA();
 
         bool checkEstimatedPose();
+
+//        while LOST: pose of curr_ from the key-frame index, back to OK on success
+        bool relocalize();
+
+        double getViewAngle(const Frame::Ptr &frame, const MapPoint::Ptr &point);
     };
 }
 
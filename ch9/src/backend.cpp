@@ -0,0 +1,223 @@
+//
+// Created by Left Thomas on 2017/9/12.
+//
+
+#include "myslam/backend.h"
+#include "myslam/projection_jacobian.h"
+#include <chrono>
+#include <Eigen/Dense>
+
+namespace myslam {
+//    huber threshold on the reprojection error, in pixels
+    const double HUBER_DELTA = 2.0;
+
+    Backend::Backend(int iterations) : iterations_(iterations), running_(true) {
+        thread_ = std::thread(&Backend::run, this);
+    }
+
+    Backend::~Backend() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        cond_.notify_all();
+        thread_.join();
+    }
+
+    void Backend::submit(const BAProblem::Ptr &problem) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = problem;
+        }
+        cond_.notify_one();
+    }
+
+    BAResult::Ptr Backend::takeResult() {
+        return std::atomic_exchange(&result_, BAResult::Ptr());
+    }
+
+    void Backend::run() {
+        while (true) {
+            BAProblem::Ptr problem;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return !running_ || pending_ != nullptr; });
+                if (!running_)
+                    break;
+                problem.swap(pending_);
+            }
+            BAResult::Ptr result(new BAResult);
+            optimize(*problem, iterations_, *result);
+//            publish without a lock, the tracker swaps it out whenever it is ready
+            std::atomic_store(&result_, result);
+        }
+    }
+
+    static double robustCost(double squared_error) {
+        if (squared_error <= HUBER_DELTA * HUBER_DELTA)
+            return squared_error;
+        return 2 * HUBER_DELTA * sqrt(squared_error) - HUBER_DELTA * HUBER_DELTA;
+    }
+
+//    observations behind their camera have no cost, so in_front tells which ones the cost covers:
+//    a step changing it is not comparable and gets rejected, else pushing points behind a camera would pay off
+    static double totalCost(const BAProblem &problem, const vector<SE3> &poses, const vector<Vector3d> &points,
+                            vector<char> &in_front) {
+        double cost = 0;
+        in_front.resize(problem.observations.size());
+        for (int k = 0; k < problem.observations.size(); ++k) {
+            const BAProblem::Observation &obs = problem.observations[k];
+            Vector3d p_c = poses[obs.frame] * points[obs.point];
+            in_front[k] = p_c(2, 0) > 0;
+            if (!in_front[k])
+                continue;
+            Vector2d e(problem.fx * p_c(0, 0) / p_c(2, 0) + problem.cx - obs.pixel(0, 0),
+                       problem.fy * p_c(1, 0) / p_c(2, 0) + problem.cy - obs.pixel(1, 0));
+            cost += robustCost(e.squaredNorm());
+        }
+        return cost;
+    }
+
+    void Backend::optimize(const BAProblem &problem, int iterations, BAResult &result) {
+        auto t1 = std::chrono::steady_clock::now();
+        typedef Eigen::Matrix<double, 6, 3> Matrix63d;
+
+        const int num_frames = static_cast<int>(problem.poses.size());
+        const int num_points = static_cast<int>(problem.points.size());
+        const int num_obs = static_cast<int>(problem.observations.size());
+        vector<SE3> poses = problem.poses;
+        vector<Vector3d> points = problem.points;
+
+//        position of every free pose in the reduced camera system
+        vector<int> pose_index(num_frames, -1);
+        int num_free = 0;
+        for (int i = 0; i < num_frames; ++i) {
+            if (!problem.fixed[i])
+                pose_index[i] = num_free++;
+        }
+        vector<vector<int>> point_obs(num_points);
+        for (int k = 0; k < num_obs; ++k)
+            point_obs[problem.observations[k].point].push_back(k);
+
+        Eigen::MatrixXd Hpp(6 * num_free, 6 * num_free), S(6 * num_free, 6 * num_free);
+        Eigen::VectorXd bp(6 * num_free), bs(6 * num_free), dx(6 * num_free);
+        vector<Eigen::Matrix3d> Hll(num_points);
+        vector<Vector3d> bl(num_points);
+        vector<Matrix63d> Hpl(num_obs);
+        vector<Eigen::Matrix3d> Hll_inv(num_points);
+
+        vector<char> in_front, new_in_front;
+        double cost = totalCost(problem, poses, points, in_front);
+        result.initial_cost = cost;
+        double lambda = -1;
+        int iter = 0;
+        for (; iter < iterations; ++iter) {
+//            normal equations with huber weights
+            Hpp.setZero();
+            bp.setZero();
+            for (int j = 0; j < num_points; ++j) {
+                Hll[j].setZero();
+                bl[j].setZero();
+            }
+            for (int k = 0; k < num_obs; ++k) {
+                const BAProblem::Observation &obs = problem.observations[k];
+                Hpl[k].setZero();
+                const SE3 &T = poses[obs.frame];
+                Vector3d p_c = T * points[obs.point];
+                if (p_c(2, 0) <= 0)
+                    continue;
+                Vector2d e(problem.fx * p_c(0, 0) / p_c(2, 0) + problem.cx - obs.pixel(0, 0),
+                           problem.fy * p_c(1, 0) / p_c(2, 0) + problem.cy - obs.pixel(1, 0));
+                double norm = e.norm();
+                double w = norm <= HUBER_DELTA ? 1.0 : HUBER_DELTA / norm;
+                Eigen::Matrix<double, 2, 3> Jl = jacobianPixelToPoint(p_c, problem.fx, problem.fy) *
+                                                 T.rotation_matrix();
+                Hll[obs.point] += w * Jl.transpose() * Jl;
+                bl[obs.point] -= w * Jl.transpose() * e;
+                int f = pose_index[obs.frame];
+                if (f < 0)
+                    continue;
+                Eigen::Matrix<double, 2, 6> Jp = jacobianPixelToPose(p_c, problem.fx, problem.fy);
+                Hpp.block<6, 6>(6 * f, 6 * f) += w * Jp.transpose() * Jp;
+                bp.segment<6>(6 * f) -= w * Jp.transpose() * e;
+                Hpl[k] = w * Jp.transpose() * Jl;
+            }
+            if (lambda < 0) {
+                double max_diag = 0;
+                for (int i = 0; i < Hpp.rows(); ++i)
+                    max_diag = max(max_diag, Hpp(i, i));
+                for (int j = 0; j < num_points; ++j)
+                    max_diag = max(max_diag, Hll[j].diagonal().maxCoeff());
+                lambda = 1e-4 * max(max_diag, 1.0);
+            }
+
+//            try damping values until the cost goes down
+            bool improved = false;
+            while (!improved && lambda < 1e10) {
+//                reduced camera system S dx = bs, the landmarks are eliminated
+                S = Hpp;
+                S.diagonal().array() += lambda;
+                bs = bp;
+                for (int j = 0; j < num_points; ++j) {
+                    Eigen::Matrix3d H = Hll[j];
+                    H.diagonal().array() += lambda;
+                    Hll_inv[j] = H.inverse();
+                    const vector<int> &obs_j = point_obs[j];
+                    for (int a:obs_j) {
+                        int fa = pose_index[problem.observations[a].frame];
+                        if (fa < 0)
+                            continue;
+                        Matrix63d W = Hpl[a] * Hll_inv[j];
+                        bs.segment<6>(6 * fa) -= W * bl[j];
+                        for (int b:obs_j) {
+                            int fb = pose_index[problem.observations[b].frame];
+                            if (fb < 0)
+                                continue;
+                            S.block<6, 6>(6 * fa, 6 * fb) -= W * Hpl[b].transpose();
+                        }
+                    }
+                }
+                if (num_free > 0)
+                    dx = S.ldlt().solve(bs);
+
+                vector<SE3> new_poses = poses;
+                for (int i = 0; i < num_frames; ++i) {
+                    if (pose_index[i] >= 0)
+                        new_poses[i] = SE3::exp(dx.segment<6>(6 * pose_index[i])) * poses[i];
+                }
+                vector<Vector3d> new_points = points;
+                for (int j = 0; j < num_points; ++j) {
+                    Vector3d rhs = bl[j];
+                    for (int a:point_obs[j]) {
+                        int fa = pose_index[problem.observations[a].frame];
+                        if (fa >= 0)
+                            rhs -= Hpl[a].transpose() * dx.segment<6>(6 * fa);
+                    }
+                    new_points[j] += Hll_inv[j] * rhs;
+                }
+
+                double new_cost = totalCost(problem, new_poses, new_points, new_in_front);
+                if (new_cost < cost && new_in_front == in_front) {
+                    poses.swap(new_poses);
+                    points.swap(new_points);
+                    cost = new_cost;
+                    lambda = max(lambda / 3, 1e-12);
+                    improved = true;
+                } else {
+                    lambda *= 4;
+                }
+            }
+            if (!improved || (num_free > 0 && dx.norm() < 1e-8))
+                break;
+        }
+
+        result.keyframe_ids = problem.keyframe_ids;
+        result.poses = poses;
+        result.point_ids = problem.point_ids;
+        result.points = points;
+        result.iterations = iter;
+        result.final_cost = cost;
+        auto t2 = std::chrono::steady_clock::now();
+        result.time = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    }
+}
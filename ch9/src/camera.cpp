@@ -6,13 +6,10 @@
 #include "myslam/config.h"
 
 namespace myslam {
-    Camera::Camera() {
-        fx_ = Config::get<float>("camera.fx"),
-        fy_ = Config::get<float>("camera.fy"),
-        cx_ = Config::get<float>("camera.cx"),
-        cy_ = Config::get<float>("camera.cy"),
-        depth_scale_ = Config::get<float>("camera.depth_scale");
-    }
+    Camera::Camera() : Camera(Config::parameters()->camera) {}
+
+    Camera::Camera(const CameraParameters &parameters) :
+            Camera(parameters.fx, parameters.fy, parameters.cx, parameters.cy, parameters.depth_scale) {}
 
     Vector3d Camera::world2camera(const Vector3d &p_w, const SE3 &T_c_w) {
         return T_c_w * p_w;
@@ -37,5 +34,57 @@ namespace myslam {
     Vector3d Camera::pixel2world(const Vector2d &p_p, const SE3 &T_c_w, double depth) {
         return camera2world(pixel2camera(p_p, depth), T_c_w);
     }
+
+//    out = T * in, written row by row as a sum of scaled rows which Eigen vectorizes
+    static void transformPoints(const SE3 &T, const Eigen::Ref<const Points3> &in, Eigen::Ref<Points3> out) {
+        Eigen::Matrix3d R = T.rotation_matrix();
+        Vector3d t = T.translation();
+        auto x = in.row(0).array(), y = in.row(1).array(), z = in.row(2).array();
+        for (int k = 0; k < 3; ++k)
+            out.row(k).array() = R(k, 0) * x + R(k, 1) * y + R(k, 2) * z + t(k, 0);
+    }
+
+    void Camera::world2camera(const Eigen::Ref<const Points3> &p_w, const SE3 &T_c_w, Eigen::Ref<Points3> p_c) const {
+        transformPoints(T_c_w, p_w, p_c);
+    }
+
+    void Camera::camera2world(const Eigen::Ref<const Points3> &p_c, const SE3 &T_c_w, Eigen::Ref<Points3> p_w) const {
+        transformPoints(T_c_w.inverse(), p_c, p_w);
+    }
+
+    void Camera::camera2pixel(const Eigen::Ref<const Points3> &p_c, Eigen::Ref<Points2> p_p) const {
+        auto inv_z = p_c.row(2).array().inverse();
+        p_p.row(0).array() = double(fx_) * p_c.row(0).array() * inv_z + double(cx_);
+        p_p.row(1).array() = double(fy_) * p_c.row(1).array() * inv_z + double(cy_);
+    }
+
+    void Camera::pixel2camera(const Eigen::Ref<const Points2> &p_p, const Eigen::Ref<const Eigen::RowVectorXd> &depth,
+                              Eigen::Ref<Points3> p_c) const {
+        p_c.row(0).array() = (p_p.row(0).array() - double(cx_)) * depth.array() / double(fx_);
+        p_c.row(1).array() = (p_p.row(1).array() - double(cy_)) * depth.array() / double(fy_);
+        p_c.row(2) = depth;
+    }
+
+    void Camera::world2pixel(const Eigen::Ref<const Points3> &p_w, const SE3 &T_c_w, Eigen::Ref<Points2> p_p) const {
+//        the camera coordinates are never stored, each one is computed where it is used
+        Eigen::Matrix3d R = T_c_w.rotation_matrix();
+        Vector3d t = T_c_w.translation();
+        auto x = p_w.row(0).array(), y = p_w.row(1).array(), z = p_w.row(2).array();
+        auto inv_z = (R(2, 0) * x + R(2, 1) * y + R(2, 2) * z + t(2, 0)).inverse();
+        p_p.row(0).array() = double(fx_) * (R(0, 0) * x + R(0, 1) * y + R(0, 2) * z + t(0, 0)) * inv_z + double(cx_);
+        p_p.row(1).array() = double(fy_) * (R(1, 0) * x + R(1, 1) * y + R(1, 2) * z + t(1, 0)) * inv_z + double(cy_);
+    }
+
+    void Camera::pixel2world(const Eigen::Ref<const Points2> &p_p, const Eigen::Ref<const Eigen::RowVectorXd> &depth,
+                             const SE3 &T_c_w, Eigen::Ref<Points3> p_w) const {
+        SE3 T_w_c = T_c_w.inverse();
+        Eigen::Matrix3d R = T_w_c.rotation_matrix();
+        Vector3d t = T_w_c.translation();
+        auto x = (p_p.row(0).array() - double(cx_)) * depth.array() / double(fx_);
+        auto y = (p_p.row(1).array() - double(cy_)) * depth.array() / double(fy_);
+        auto z = depth.array();
+        for (int k = 0; k < 3; ++k)
+            p_w.row(k).array() = R(k, 0) * x + R(k, 1) * y + R(k, 2) * z + t(k, 0);
+    }
 }
 
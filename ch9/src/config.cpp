@@ -3,23 +3,110 @@
 //
 
 #include "myslam/config.h"
+#include <sstream>
 
 namespace myslam {
 
-    Config::~Config() {
-        if (file_.isOpened())
-            file_.release();
+    Config::~Config() = default;
+
+    bool Config::load() {
+        cv::FileStorage file(filename_.c_str(), cv::FileStorage::READ);
+        if (!file.isOpened()) {
+            cerr << "parameter file " << filename_ << " does not exist." << endl;
+            return false;
+        }
+//        every value is kept as text, Parameters::parse converts them to the types of the members
+        map<string, string> values;
+        bool ok = true;
+        cv::FileNode root = file.root();
+        for (cv::FileNodeIterator it = root.begin(); it != root.end(); ++it) {
+            cv::FileNode node = *it;
+            if (node.isString()) {
+                values[node.name()] = string(node);
+            } else if (node.isInt()) {
+                values[node.name()] = to_string(int(node));
+            } else if (node.isReal()) {
+                ostringstream oss;
+                oss.precision(17);
+                oss << double(node);
+                values[node.name()] = oss.str();
+            } else {
+                cerr << filename_ << ": " << node.name() << " is not a single value" << endl;
+                ok = false;
+            }
+        }
+        file.release();
+        Parameters::ConstPtr parameters = ok ? makeParameters(values, overrides_) : nullptr;
+        if (parameters == nullptr) {
+            cerr << "parameters of " << filename_ << " not applied." << endl;
+            return false;
+        }
+        values_ = values;
+        std::atomic_store(&parameters_, parameters);
+        return true;
     }
 
-    void Config::setParameterFile(const string &filename) {
+    Parameters::ConstPtr Config::makeParameters(map<string, string> values, const vector<string> &overrides) {
+        for (const string &text:overrides) {
+            size_t eq = text.find('=');
+            if (eq == string::npos) {
+                cerr << "expected key=value instead of " << text << endl;
+                return nullptr;
+            }
+            values[text.substr(0, eq)] = text.substr(eq + 1);
+        }
+        shared_ptr<Parameters> parameters(new Parameters);
+        if (!parameters->parse(values, cerr) || !parameters->validate(cerr))
+            return nullptr;
+        return parameters;
+    }
+
+    bool Config::setParameterFile(const string &filename, const vector<string> &overrides) {
         if (config_ == nullptr)
             config_ = shared_ptr<Config>(new Config);
-        config_->file_ = cv::FileStorage(filename.c_str(), cv::FileStorage::READ);
-        if (!config_->file_.isOpened()) {
-            cerr << "parameter file " << "does not exist." << endl;
-            config_->file_.release();
+        std::lock_guard<std::mutex> lock(config_->mutex_);
+        config_->filename_ = filename;
+        config_->overrides_ = overrides;
+        return config_->load();
+    }
+
+    vector<string> Config::overridesFromArgs(int argc, char **argv, int first, vector<string> *positional) {
+        vector<string> overrides;
+        for (int i = first; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg.find('=') != string::npos)
+                overrides.push_back(arg);
+            else if (positional != nullptr)
+                positional->push_back(arg);
         }
+        return overrides;
+    }
+
+    bool Config::reload() {
+        if (config_ == nullptr)
+            return false;
+        std::lock_guard<std::mutex> lock(config_->mutex_);
+        return config_->load();
+    }
+
+    Parameters::ConstPtr Config::parameters() {
+//        nothing read yet: the defaults
+        static const Parameters::ConstPtr defaults(new Parameters);
+        if (config_ == nullptr)
+            return defaults;
+        Parameters::ConstPtr parameters = std::atomic_load(&config_->parameters_);
+        return parameters != nullptr ? parameters : defaults;
+    }
+
+    Parameters::ConstPtr Config::derive(const vector<string> &overrides) {
+        if (config_ == nullptr)
+            return makeParameters(map<string, string>(), overrides);
+        std::lock_guard<std::mutex> lock(config_->mutex_);
+//        the command line overrides first, those of the caller win over them
+        vector<string> all_overrides = config_->overrides_;
+        all_overrides.insert(all_overrides.end(), overrides.begin(), overrides.end());
+        return makeParameters(config_->values_, all_overrides);
     }
 
     shared_ptr<Config> Config::config_ = nullptr;
-}
\ No newline at end of file
+}
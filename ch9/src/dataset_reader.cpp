@@ -0,0 +1,103 @@
+//
+// Created by Left Thomas on 2017/9/16.
+//
+
+#include "myslam/dataset_reader.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <opencv2/highgui/highgui.hpp>
+
+namespace myslam {
+
+    DatasetReader::DatasetReader(const std::string &dataset_dir, int num_workers, size_t queue_size) :
+            opened_(false), next_decode_(0), next_out_(0), stop_(false) {
+        std::ifstream fin(dataset_dir + "/associate.txt");
+        if (!fin) {
+            std::cerr << "cannot open " << dataset_dir << "/associate.txt" << std::endl;
+            return;
+        }
+        opened_ = true;
+        std::string line;
+        while (std::getline(fin, line)) {
+            std::istringstream iss(line);
+            Entry entry;
+            if (!(iss >> entry.color_time >> entry.color_file >> entry.depth_time >> entry.depth_file))
+                continue;
+            entry.color_file = dataset_dir + "/" + entry.color_file;
+            entry.depth_file = dataset_dir + "/" + entry.depth_file;
+            entries_.push_back(entry);
+        }
+
+        ring_.resize(queue_size > 0 ? queue_size : 1);
+        ready_.assign(ring_.size(), false);
+        num_workers = std::max(num_workers, 1);
+        for (int i = 0; i < num_workers; ++i)
+            workers_.emplace_back(&DatasetReader::decodeLoop, this);
+    }
+
+    DatasetReader::~DatasetReader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        consumed_.notify_all();
+        decoded_.notify_all();
+        for (std::thread &t:workers_)
+            t.join();
+    }
+
+    void DatasetReader::decodeLoop() {
+        const size_t capacity = ring_.size();
+        while (true) {
+            size_t index;
+            {
+//                an entry is only taken once its slot in the ring has been handed out
+                std::unique_lock<std::mutex> lock(mutex_);
+                consumed_.wait(lock, [&] {
+                    return stop_ || next_decode_ >= entries_.size() || next_decode_ < next_out_ + capacity;
+                });
+                if (stop_ || next_decode_ >= entries_.size())
+                    return;
+                index = next_decode_++;
+            }
+
+            const Entry &entry = entries_[index];
+            Image image;
+            image.index = index;
+            image.time_stamp = entry.color_time;
+            image.color = cv::imread(entry.color_file);
+            image.depth = cv::imread(entry.depth_file, -1);
+            if (image.color.data == nullptr || image.depth.data == nullptr) {
+                std::cerr << "cannot read " << entry.color_file << " or " << entry.depth_file << std::endl;
+                image.color = cv::Mat();
+                image.depth = cv::Mat();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ring_[index % capacity] = image;
+                ready_[index % capacity] = true;
+            }
+            decoded_.notify_all();
+        }
+    }
+
+    bool DatasetReader::next(Image &image) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (next_out_ >= entries_.size())
+            return false;
+        const size_t slot = next_out_ % ring_.size();
+        decoded_.wait(lock, [&] { return stop_ || ready_[slot]; });
+        if (!ready_[slot])
+            return false;
+        image = ring_[slot];
+        ring_[slot] = Image();
+        ready_[slot] = false;
+        next_out_++;
+        lock.unlock();
+        consumed_.notify_all();
+        return true;
+    }
+}
@@ -3,43 +3,79 @@
 //
 
 #include "myslam/frame.h"
+#include <atomic>
 
 namespace myslam {
+//    frames are created on the decoding threads
+    static std::atomic<unsigned long> factory_id(0);
 
 
-    Frame::Frame() : id_(static_cast<unsigned long>(-1)), time_stamp_(-1), camera_(nullptr) {
+    Frame::Frame() : id_(static_cast<unsigned long>(-1)), time_stamp_(-1), camera_(nullptr), has_depth_map_(false),
+                     detect_time_(0), describe_time_(0), is_key_frame_(false) {
 
     }
 
     Frame::Frame(unsigned long id_, double time_stamp_, const SE3 &T_c_w, const Camera::Ptr &camera_, const Mat &color_,
                  const Mat &depth_) : id_(id_), time_stamp_(time_stamp_), T_c_w_(T_c_w), camera_(camera_),
-                                      color_(color_), depth_(depth_) {}
+                                      color_(color_), depth_(depth_), has_depth_map_(false), detect_time_(0),
+                                      describe_time_(0), is_key_frame_(false) {}
 
     Frame::~Frame() = default;
 
     Frame::Ptr Frame::createFrame() {
-        static unsigned long factory_id = 0;
         return Frame::Ptr(new Frame(factory_id++));
     }
 
+    void Frame::recycle() {
+        id_ = factory_id++;
+        time_stamp_ = -1;
+        T_c_w_ = SE3();
+        color_.release();
+        depth_.release();
+//        depth_map_ keeps its buffer for the next image of the same size
+        has_depth_map_ = false;
+        keypoints_.clear();
+//        no rows but the same buffer, see ORBExtractor::extract
+        if (!descriptors_.empty())
+            descriptors_.resize(0);
+        detect_time_ = describe_time_ = 0;
+        is_key_frame_ = false;
+        map_points_.clear();
+    }
+
+    void Frame::prepareDepth() {
+        const int rows = depth_.rows, cols = depth_.cols;
+        const float scale = 1.0f / camera_->depth_scale_;
+        depth_map_.create(rows, cols, CV_32F);
+        for (int y = 0; y < rows; ++y) {
+            const ushort *up = depth_.ptr<ushort>(max(y - 1, 0));
+            const ushort *row = depth_.ptr<ushort>(y);
+            const ushort *down = depth_.ptr<ushort>(min(y + 1, rows - 1));
+            float *out = depth_map_.ptr<float>(y);
+            for (int x = 0; x < cols; ++x) {
+                ushort d = row[x];
+//                a hole takes the first valid of left, up, right and down, the order findDepth used to try them.
+//                at the border the missing neighbour is replaced by the pixel itself, which is 0
+                if (d == 0) {
+                    ushort nearby[4] = {row[max(x - 1, 0)], up[x], row[min(x + 1, cols - 1)], down[x]};
+                    for (int i = 0; i < 4 && d == 0; ++i)
+                        d = nearby[i];
+                }
+                out[x] = d * scale;
+            }
+        }
+        has_depth_map_ = true;
+    }
+
     double Frame::findDepth(const cv::KeyPoint &kp) {
+        if (!has_depth_map_)
+            prepareDepth();
         int x = cvRound(kp.pt.x);
         int y = cvRound(kp.pt.y);
-        ushort d = depth_.ptr<ushort>(y)[x];
-        if (d != 0) {
-            return double(d) / camera_->depth_scale_;
-        }
-//      check the nearby 4 points
-        int dx[4] = {-1, 0, 1, 0};
-        int dy[4] = {0, -1, 0, 1};
-        for (int i = 0; i < 4; ++i) {
-            d = depth_.ptr<ushort>(y + dy[i])[x + dx[i]];
-            if (d != 0) {
-                return double(d) / camera_->depth_scale_;
-            }
-        }
-//        other while
-        return -1.0;
+        if (x < 0 || y < 0 || x >= depth_map_.cols || y >= depth_map_.rows)
+            return -1.0;
+        float d = depth_map_.ptr<float>(y)[x];
+        return d > 0 ? d : -1.0;
     }
 
     Vector3d Frame::getCameraCenter() const {
@@ -54,4 +90,8 @@ namespace myslam {
         return p_pixel(0, 0) > 0 && p_pixel(1, 0) > 0 && p_pixel(0, 0) < color_.cols && p_pixel(1, 0) < color_.rows;
     }
 
+    bool Frame::hasFeatures() const {
+        return !keypoints_.empty() && descriptors_.rows == static_cast<int>(keypoints_.size());
+    }
+
 }
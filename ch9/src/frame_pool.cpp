@@ -0,0 +1,41 @@
+//
+// Created by Left Thomas on 2017/9/18.
+//
+
+#include "myslam/frame_pool.h"
+#include <atomic>
+
+namespace myslam {
+
+    FramePool::FramePool(size_t capacity) : capacity_(max<size_t>(capacity, 1)), next_(0), acquisitions_(0) {
+        frames_.reserve(capacity_);
+        stamps_.reserve(capacity_);
+    }
+
+    Frame::Ptr FramePool::acquire() {
+        acquisitions_++;
+        for (size_t k = 0; k < frames_.size(); ++k) {
+            size_t i = (next_ + k) % frames_.size();
+            Frame::Ptr &frame = frames_[i];
+            if (frame.use_count() == 1) {
+//                pairs with the release of the last other owner, its writes to the frame are visible
+                std::atomic_thread_fence(std::memory_order_acquire);
+                frame->recycle();
+            } else if (stamps_[i] + capacity_ < acquisitions_) {
+//                held for too long, the owner keeps it and the slot starts over
+                frame = Frame::createFrame();
+            } else {
+                continue;
+            }
+            stamps_[i] = acquisitions_;
+            next_ = i + 1;
+            return frame;
+        }
+        Frame::Ptr frame = Frame::createFrame();
+        if (frames_.size() < capacity_) {
+            frames_.push_back(frame);
+            stamps_.push_back(acquisitions_);
+        }
+        return frame;
+    }
+}
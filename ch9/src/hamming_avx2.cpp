@@ -0,0 +1,43 @@
+//
+// Created by Left Thomas on 2017/9/10.
+// built with -mavx2, only called when the CPU supports it
+//
+
+#include "myslam/hamming_kernels.h"
+#include <immintrin.h>
+
+namespace myslam {
+//    per byte popcount of a 256 bit register, summed into its four 64 bit lanes
+    static inline __m256i popcount256(__m256i v) {
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_mask = _mm256_set1_epi8(0x0f);
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+        return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+    }
+
+    void hammingDistance4AVX2(const unsigned char *query, const unsigned char *train, size_t step, int *out) {
+        __m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(query));
+        __m256i s0 = popcount256(_mm256_xor_si256(q, _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(train))));
+        __m256i s1 = popcount256(_mm256_xor_si256(q, _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(train + step))));
+        __m256i s2 = popcount256(_mm256_xor_si256(q, _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(train + 2 * step))));
+        __m256i s3 = popcount256(_mm256_xor_si256(q, _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(train + 3 * step))));
+//        horizontal sums of the four registers, one per 64 bit lane
+        __m256i t01 = _mm256_add_epi64(_mm256_unpacklo_epi64(s0, s1), _mm256_unpackhi_epi64(s0, s1));
+        __m256i t23 = _mm256_add_epi64(_mm256_unpacklo_epi64(s2, s3), _mm256_unpackhi_epi64(s2, s3));
+        __m256i sum = _mm256_add_epi64(_mm256_permute2x128_si256(t01, t23, 0x20),
+                                       _mm256_permute2x128_si256(t01, t23, 0x31));
+        alignas(32) long long d[4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(d), sum);
+        out[0] = static_cast<int>(d[0]);
+        out[1] = static_cast<int>(d[1]);
+        out[2] = static_cast<int>(d[2]);
+        out[3] = static_cast<int>(d[3]);
+    }
+}
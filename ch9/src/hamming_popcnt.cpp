@@ -0,0 +1,17 @@
+//
+// Created by Left Thomas on 2017/9/10.
+// built with -mpopcnt, only called when the CPU supports it
+//
+
+#include "myslam/hamming_kernels.h"
+#include <nmmintrin.h>
+
+namespace myslam {
+    int hammingDistancePOPCNT(const unsigned char *a, const unsigned char *b) {
+        unsigned long long x[4], y[4];
+        __builtin_memcpy(x, a, 32);
+        __builtin_memcpy(y, b, 32);
+        return static_cast<int>(_mm_popcnt_u64(x[0] ^ y[0]) + _mm_popcnt_u64(x[1] ^ y[1]) +
+                                _mm_popcnt_u64(x[2] ^ y[2]) + _mm_popcnt_u64(x[3] ^ y[3]));
+    }
+}
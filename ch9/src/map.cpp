@@ -0,0 +1,21 @@
+//
+// Created by Left Thomas on 2017/9/11.
+//
+
+#include "myslam/map.h"
+
+namespace myslam {
+
+    void Map::insertKeyFrame(const Frame::Ptr &frame) {
+        frame->is_key_frame_ = true;
+        keyframes_[frame->id_] = frame;
+    }
+
+    void Map::eraseKeyFrame(unsigned long id) {
+        keyframes_.erase(id);
+    }
+
+    void Map::insertMapPoint(const MapPoint::Ptr &map_point) {
+        map_points_[map_point->id_] = map_point;
+    }
+}
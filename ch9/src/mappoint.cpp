@@ -0,0 +1,24 @@
+//
+// Created by Left Thomas on 2017/9/11.
+//
+
+#include "myslam/mappoint.h"
+#include <atomic>
+
+namespace myslam {
+
+    MapPoint::MapPoint() : id_(static_cast<unsigned long>(-1)), good_(true), pos_(Vector3d(0, 0, 0)),
+                           norm_(Vector3d(0, 0, 0)), visible_times_(0), matched_times_(0), observed_times_(0) {
+
+    }
+
+    MapPoint::MapPoint(unsigned long id, const Vector3d &position, const Vector3d &norm, const Mat &descriptor) :
+            id_(id), good_(true), pos_(position), norm_(norm), descriptor_(descriptor), visible_times_(1),
+            matched_times_(1), observed_times_(0) {}
+
+    MapPoint::Ptr MapPoint::createMapPoint(const Vector3d &pos_world, const Vector3d &norm, const Mat &descriptor) {
+//        several VOs may create points at the same time
+        static std::atomic<unsigned long> factory_id(0);
+        return MapPoint::Ptr(new MapPoint(factory_id++, pos_world, norm, descriptor));
+    }
+}
@@ -0,0 +1,253 @@
+//
+// Created by Left Thomas on 2017/9/9.
+//
+
+#include "myslam/orb_extractor.h"
+#include <chrono>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+
+namespace myslam {
+//    patch used by ORB for orientation and descriptor
+    const int PATCH_SIZE = 31;
+    const int HALF_PATCH_SIZE = 15;
+//    keypoints closer to the border than this have no full descriptor patch
+    const int EDGE_THRESHOLD = 19;
+//    radius of the FAST circle
+    const int FAST_RADIUS = 3;
+
+//    runs one member function over a range of tasks through cv::parallel_for_
+    class ExtractorBody : public cv::ParallelLoopBody {
+    public:
+        ExtractorBody(ORBExtractor *extractor, void (ORBExtractor::*task)(int)) :
+                extractor_(extractor), task_(task) {}
+
+        void operator()(const cv::Range &range) const override {
+            for (int i = range.start; i < range.end; ++i)
+                (extractor_->*task_)(i);
+        }
+
+    private:
+        ORBExtractor *extractor_;
+        void (ORBExtractor::*task_)(int);
+    };
+
+    ORBExtractor::ORBExtractor(int num_features, float scale_factor, int num_levels, int cell_size,
+                               int fast_threshold, int min_fast_threshold) :
+            num_features_(num_features), num_levels_(max(num_levels, 1)), cell_size_(max(cell_size, 8)),
+            fast_threshold_(fast_threshold), min_fast_threshold_(min_fast_threshold) {
+        scale_per_level_.resize(num_levels_);
+        scale_per_level_[0] = 1.0f;
+        for (int i = 1; i < num_levels_; ++i)
+            scale_per_level_[i] = scale_per_level_[i - 1] * scale_factor;
+
+//        spread the budget over the levels as a geometric series, like cv::ORB
+        features_per_level_.resize(num_levels_);
+        float factor = 1.0f / scale_factor;
+        float desired = num_features_ * (1 - factor) / (1 - pow(factor, num_levels_));
+        int sum = 0;
+        for (int i = 0; i < num_levels_ - 1; ++i) {
+            features_per_level_[i] = cvRound(desired);
+            sum += features_per_level_[i];
+            desired *= factor;
+        }
+        features_per_level_[num_levels_ - 1] = max(num_features_ - sum, 0);
+
+        umax_.resize(HALF_PATCH_SIZE + 1);
+        int vmax = cvFloor(HALF_PATCH_SIZE * sqrt(2.f) / 2 + 1);
+        int vmin = cvCeil(HALF_PATCH_SIZE * sqrt(2.f) / 2);
+        const double hp2 = HALF_PATCH_SIZE * HALF_PATCH_SIZE;
+        for (int v = 0; v <= vmax; ++v)
+            umax_[v] = cvRound(sqrt(hp2 - v * v));
+//        make sure the patch is symmetric
+        for (int v = HALF_PATCH_SIZE, v0 = 0; v >= vmin; --v) {
+            while (umax_[v0] == umax_[v0 + 1])
+                ++v0;
+            umax_[v] = v0;
+            ++v0;
+        }
+
+        for (int i = 0; i < num_levels_; ++i)
+            describers_.push_back(cv::ORB::create(max(features_per_level_[i], 1), scale_factor, 1,
+                                                  EDGE_THRESHOLD, 0, 2, cv::ORB::HARRIS_SCORE, PATCH_SIZE));
+        pyramid_.resize(num_levels_);
+        level_keypoints_.resize(num_levels_);
+        level_descriptors_.resize(num_levels_);
+    }
+
+    void ORBExtractor::extract(const Mat &image, vector<cv::KeyPoint> &keypoints, Mat &descriptors) {
+        auto t1 = std::chrono::steady_clock::now();
+        keypoints.clear();
+        if (image.empty()) {
+            descriptors = Mat();
+            return;
+        }
+        if (image.channels() == 3) {
+            cv::cvtColor(image, gray_, cv::COLOR_BGR2GRAY);
+            computePyramid(gray_);
+        } else {
+            computePyramid(image);
+        }
+
+//        the cells of every level, with a FAST_RADIUS margin so corners on the cell border are found
+        cells_.clear();
+        cells_per_level_.assign(num_levels_, 0);
+        for (int level = 0; level < num_levels_; ++level) {
+            const Mat &img = pyramid_[level];
+            int min_x = EDGE_THRESHOLD - FAST_RADIUS, max_x = img.cols - EDGE_THRESHOLD + FAST_RADIUS;
+            int min_y = EDGE_THRESHOLD - FAST_RADIUS, max_y = img.rows - EDGE_THRESHOLD + FAST_RADIUS;
+            if (max_x - min_x <= 2 * FAST_RADIUS || max_y - min_y <= 2 * FAST_RADIUS)
+                continue;
+            for (int y = min_y; y < max_y - 2 * FAST_RADIUS; y += cell_size_) {
+                for (int x = min_x; x < max_x - 2 * FAST_RADIUS; x += cell_size_) {
+                    int w = min(cell_size_ + 2 * FAST_RADIUS, max_x - x);
+                    int h = min(cell_size_ + 2 * FAST_RADIUS, max_y - y);
+                    cells_.push_back(Cell{level, cv::Rect(x, y, w, h)});
+                    cells_per_level_[level]++;
+                }
+            }
+        }
+        cell_keypoints_.resize(cells_.size());
+        cell_spare_.resize(cells_.size());
+        cv::parallel_for_(cv::Range(0, static_cast<int>(cells_.size())),
+                          ExtractorBody(this, &ORBExtractor::detectInCell));
+
+//        gather the cells of each level, strongest leftovers fill the quota of empty cells
+        vector<cv::KeyPoint> &spare = spare_;
+        int i = 0;
+        for (int level = 0; level < num_levels_; ++level) {
+            vector<cv::KeyPoint> &kps = level_keypoints_[level];
+            kps.clear();
+            spare.clear();
+            for (int c = 0; c < cells_per_level_[level]; ++c, ++i) {
+                kps.insert(kps.end(), cell_keypoints_[i].begin(), cell_keypoints_[i].end());
+                spare.insert(spare.end(), cell_spare_[i].begin(), cell_spare_[i].end());
+            }
+            int budget = features_per_level_[level];
+            if (kps.size() > budget) {
+                cv::KeyPointsFilter::retainBest(kps, budget);
+                kps.resize(min<size_t>(kps.size(), budget));
+            } else if (kps.size() < budget && !spare.empty()) {
+                cv::KeyPointsFilter::retainBest(spare, budget - static_cast<int>(kps.size()));
+                size_t n = min<size_t>(spare.size(), budget - kps.size());
+                kps.insert(kps.end(), spare.begin(), spare.begin() + n);
+            }
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+        cv::parallel_for_(cv::Range(0, num_levels_), ExtractorBody(this, &ORBExtractor::describeLevel));
+
+//        back to level 0 coordinates
+        int total = 0;
+        for (int level = 0; level < num_levels_; ++level)
+            total += static_cast<int>(level_keypoints_[level].size());
+        keypoints.reserve(total);
+//        a recycled frame brings its descriptor buffer, the rows are only reallocated when it is too small
+        if (descriptors.data == nullptr || descriptors.type() != CV_8U || descriptors.cols != 32)
+            descriptors.create(max(total, num_features_), 32, CV_8U);
+        descriptors.resize(total);
+        int row = 0;
+        for (int level = 0; level < num_levels_; ++level) {
+            float scale = scale_per_level_[level];
+            for (cv::KeyPoint kp:level_keypoints_[level]) {
+                kp.pt.x *= scale;
+                kp.pt.y *= scale;
+                kp.size = PATCH_SIZE * scale;
+                kp.octave = level;
+                keypoints.push_back(kp);
+            }
+            if (!level_descriptors_[level].empty()) {
+                Mat rows = descriptors.rowRange(row, row + level_descriptors_[level].rows);
+                level_descriptors_[level].copyTo(rows);
+                row += level_descriptors_[level].rows;
+            }
+        }
+        auto t3 = std::chrono::steady_clock::now();
+        detect_time_ = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        describe_time_ = std::chrono::duration<double, std::milli>(t3 - t2).count();
+    }
+
+    void ORBExtractor::computePyramid(const Mat &gray) {
+        pyramid_[0] = gray;
+        for (int level = 1; level < num_levels_; ++level) {
+            float inv_scale = 1.0f / scale_per_level_[level];
+            cv::Size size(cvRound(gray.cols * inv_scale), cvRound(gray.rows * inv_scale));
+            cv::resize(pyramid_[level - 1], pyramid_[level], size, 0, 0, cv::INTER_LINEAR);
+        }
+    }
+
+    void ORBExtractor::detectInCell(int index) {
+        const Cell &cell = cells_[index];
+        const Mat &img = pyramid_[cell.level];
+        vector<cv::KeyPoint> &kps = cell_keypoints_[index];
+        vector<cv::KeyPoint> &spare = cell_spare_[index];
+        kps.clear();
+        spare.clear();
+
+        Mat patch = img(cell.roi);
+        cv::FAST(patch, kps, fast_threshold_, true);
+        if (kps.empty())
+            cv::FAST(patch, kps, min_fast_threshold_, true);
+
+//        drop the corners in the margin, those belong to the neighbour cell or lack a descriptor patch
+        int min_x = EDGE_THRESHOLD, max_x = img.cols - EDGE_THRESHOLD;
+        int min_y = EDGE_THRESHOLD, max_y = img.rows - EDGE_THRESHOLD;
+        int cell_max_x = cell.roi.x + cell.roi.width - FAST_RADIUS;
+        int cell_max_y = cell.roi.y + cell.roi.height - FAST_RADIUS;
+        size_t n = 0;
+        for (cv::KeyPoint &kp:kps) {
+            kp.pt.x += cell.roi.x;
+            kp.pt.y += cell.roi.y;
+            if (kp.pt.x < min_x || kp.pt.x >= min(max_x, cell_max_x) ||
+                kp.pt.y < min_y || kp.pt.y >= min(max_y, cell_max_y))
+                continue;
+            kps[n++] = kp;
+        }
+        kps.resize(n);
+
+//        quota of this cell, the rest is kept aside for cells that found nothing
+        int quota = max(1, cvCeil(float(features_per_level_[cell.level]) / cells_per_level_[cell.level]));
+        if (kps.size() > quota) {
+            sort(kps.begin(), kps.end(), [](const cv::KeyPoint &k1, const cv::KeyPoint &k2) {
+                return k1.response > k2.response;
+            });
+            spare.assign(kps.begin() + quota, kps.end());
+            kps.resize(quota);
+        }
+    }
+
+    void ORBExtractor::describeLevel(int level) {
+        vector<cv::KeyPoint> &kps = level_keypoints_[level];
+        if (kps.empty()) {
+            level_descriptors_[level].release();
+            return;
+        }
+        for (cv::KeyPoint &kp:kps) {
+            kp.angle = computeAngle(pyramid_[level], kp.pt);
+            kp.octave = 0;
+            kp.size = PATCH_SIZE;
+        }
+//        the keypoints are given, so the describer only blurs this level and samples the rBRIEF pattern
+        describers_[level]->compute(pyramid_[level], kps, level_descriptors_[level]);
+    }
+
+//    intensity centroid orientation
+    float ORBExtractor::computeAngle(const Mat &image, const cv::Point2f &pt) const {
+        int m_01 = 0, m_10 = 0;
+        const uchar *center = &image.at<uchar>(cvRound(pt.y), cvRound(pt.x));
+        for (int u = -HALF_PATCH_SIZE; u <= HALF_PATCH_SIZE; ++u)
+            m_10 += u * center[u];
+        int step = static_cast<int>(image.step1());
+        for (int v = 1; v <= HALF_PATCH_SIZE; ++v) {
+            int v_sum = 0;
+            int d = umax_[v];
+            for (int u = -d; u <= d; ++u) {
+                int val_plus = center[u + v * step], val_minus = center[u - v * step];
+                v_sum += (val_plus - val_minus);
+                m_10 += u * (val_plus + val_minus);
+            }
+            m_01 += v * v_sum;
+        }
+        return cv::fastAtan2(float(m_01), float(m_10));
+    }
+}
@@ -0,0 +1,138 @@
+//
+// Created by Left Thomas on 2017/9/10.
+//
+
+#include "myslam/orb_matcher.h"
+#include "myslam/hamming_kernels.h"
+#include <cstring>
+#include <climits>
+
+namespace myslam {
+
+//    the kernels are only built on x86 (MYSLAM_HAMMING_KERNELS), and only used if this CPU has their instructions
+    static bool cpuHasAVX2() {
+#ifdef MYSLAM_HAMMING_KERNELS
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    static bool cpuHasPOPCNT() {
+#ifdef MYSLAM_HAMMING_KERNELS
+        static const bool supported = __builtin_cpu_supports("popcnt");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    static int hammingDistanceScalar(const uchar *a, const uchar *b) {
+        uint64_t x[4], y[4];
+        memcpy(x, a, ORBMatcher::DESCRIPTOR_BYTES);
+        memcpy(y, b, ORBMatcher::DESCRIPTOR_BYTES);
+        return __builtin_popcountll(x[0] ^ y[0]) + __builtin_popcountll(x[1] ^ y[1]) +
+               __builtin_popcountll(x[2] ^ y[2]) + __builtin_popcountll(x[3] ^ y[3]);
+    }
+
+    int ORBMatcher::distance(const uchar *a, const uchar *b) {
+#ifdef MYSLAM_HAMMING_KERNELS
+        if (cpuHasPOPCNT())
+            return hammingDistancePOPCNT(a, b);
+#endif
+        return hammingDistanceScalar(a, b);
+    }
+
+    void ORBMatcher::match(const Mat &query, const Mat &train, vector<cv::DMatch> &matches) {
+        matches.clear();
+        if (query.empty() || train.empty())
+            return;
+        CV_Assert(query.cols == DESCRIPTOR_BYTES && train.cols == DESCRIPTOR_BYTES);
+        matches.reserve(query.rows);
+        const bool use_avx2 = cpuHasAVX2();
+        for (int i = 0; i < query.rows; ++i) {
+            const uchar *q = query.ptr<uchar>(i);
+            int best = INT_MAX, best_idx = -1;
+            int j = 0;
+#ifdef MYSLAM_HAMMING_KERNELS
+            int d[4];
+            for (; use_avx2 && j + 4 <= train.rows; j += 4) {
+                hammingDistance4AVX2(q, train.ptr<uchar>(j), train.step[0], d);
+                for (int k = 0; k < 4; ++k) {
+                    if (d[k] < best) {
+                        best = d[k];
+                        best_idx = j + k;
+                    }
+                }
+            }
+#endif
+            for (; j < train.rows; ++j) {
+                int d = distance(q, train.ptr<uchar>(j));
+                if (d < best) {
+                    best = d;
+                    best_idx = j;
+                }
+            }
+            matches.emplace_back(i, best_idx, static_cast<float>(best));
+        }
+    }
+
+    void ORBMatcher::buildGrid(const vector<cv::KeyPoint> &keypoints, float cell_size) {
+        float max_x = 0, max_y = 0;
+        for (const cv::KeyPoint &kp:keypoints) {
+            max_x = max(max_x, kp.pt.x);
+            max_y = max(max_y, kp.pt.y);
+        }
+        cell_size_ = max(cell_size, 1.0f);
+        grid_cols_ = static_cast<int>(max_x / cell_size_) + 1;
+        grid_rows_ = static_cast<int>(max_y / cell_size_) + 1;
+//        clear the cells but keep their memory for the next frame
+        for (vector<int> &cell:grid_)
+            cell.clear();
+        if (grid_.size() < grid_cols_ * grid_rows_)
+            grid_.resize(grid_cols_ * grid_rows_);
+        for (int i = 0; i < keypoints.size(); ++i) {
+            int cx = static_cast<int>(max(keypoints[i].pt.x, 0.0f) / cell_size_);
+            int cy = static_cast<int>(max(keypoints[i].pt.y, 0.0f) / cell_size_);
+            grid_[cy * grid_cols_ + cx].push_back(i);
+        }
+    }
+
+    void ORBMatcher::matchInWindow(const Mat &query, const vector<cv::Point2f> &predicted,
+                                   const vector<cv::KeyPoint> &train_keypoints, const Mat &train, float radius,
+                                   vector<cv::DMatch> &matches) {
+        matches.clear();
+        if (query.empty() || train.empty())
+            return;
+        CV_Assert(query.cols == DESCRIPTOR_BYTES && train.cols == DESCRIPTOR_BYTES);
+        CV_Assert(predicted.size() == query.rows && train_keypoints.size() == train.rows);
+        buildGrid(train_keypoints, radius);
+        const float radius2 = radius * radius;
+        for (int i = 0; i < query.rows; ++i) {
+            const cv::Point2f &p = predicted[i];
+            if (p.x < 0 || p.y < 0)
+                continue;
+            int cx = static_cast<int>(p.x / cell_size_), cy = static_cast<int>(p.y / cell_size_);
+            const uchar *q = query.ptr<uchar>(i);
+            int best = INT_MAX, best_idx = -1;
+//            the window of radius r is covered by the 3x3 cells around the prediction
+            for (int y = max(cy - 1, 0); y <= min(cy + 1, grid_rows_ - 1); ++y) {
+                for (int x = max(cx - 1, 0); x <= min(cx + 1, grid_cols_ - 1); ++x) {
+                    for (int j:grid_[y * grid_cols_ + x]) {
+                        float dx = train_keypoints[j].pt.x - p.x, dy = train_keypoints[j].pt.y - p.y;
+                        if (dx * dx + dy * dy > radius2)
+                            continue;
+                        int d = distance(q, train.ptr<uchar>(j));
+                        if (d < best) {
+                            best = d;
+                            best_idx = j;
+                        }
+                    }
+                }
+            }
+            if (best_idx >= 0)
+                matches.emplace_back(i, best_idx, static_cast<float>(best));
+        }
+    }
+}
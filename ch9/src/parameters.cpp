@@ -0,0 +1,141 @@
+//
+// Created by Left Thomas on 2017/9/19.
+//
+
+#include "myslam/parameters.h"
+#include <sstream>
+
+namespace myslam {
+
+    template<typename T>
+    static bool parseValue(const string &text, T &value) {
+        istringstream iss(text);
+        T parsed;
+        if (!(iss >> parsed) || !(iss >> ws).eof())
+            return false;
+        value = parsed;
+        return true;
+    }
+
+    static bool parseValue(const string &text, string &value) {
+        value = text;
+        return true;
+    }
+
+//    binds the keys of the file to the members, every known key is listed exactly once here
+    template<typename Visitor>
+    static void visitParameters(Parameters &p, Visitor &&visit) {
+        visit("dataset_dir", p.dataset_dir);
+        visit("dataset_pack", p.dataset_pack);
+        visit("decode_threads", p.decode_threads);
+        visit("decode_queue_size", p.decode_queue_size);
+        visit("camera.fx", p.camera.fx);
+        visit("camera.fy", p.camera.fy);
+        visit("camera.cx", p.camera.cx);
+        visit("camera.cy", p.camera.cy);
+        visit("camera.depth_scale", p.camera.depth_scale);
+        visit("number_of_features", p.vo.number_of_features);
+        visit("scale_factor", p.vo.scale_factor);
+        visit("level_pyramid", p.vo.level_pyramid);
+        visit("cell_size", p.vo.cell_size);
+        visit("fast_threshold", p.vo.fast_threshold);
+        visit("min_fast_threshold", p.vo.min_fast_threshold);
+        visit("match_ratio", p.vo.match_ratio);
+        visit("match_window", p.vo.match_window);
+        visit("max_num_lost", p.vo.max_num_lost);
+        visit("min_inliers", p.vo.min_inliers);
+        visit("pnp_iterations", p.vo.pnp_iterations);
+        visit("pnp_confidence", p.vo.pnp_confidence);
+        visit("pose_refine_iterations", p.vo.pose_refine_iterations);
+        visit("map_point_erase_ratio", p.vo.map_point_erase_ratio);
+        visit("min_map_matches", p.vo.min_map_matches);
+        visit("max_map_points", p.vo.max_map_points);
+        visit("keyframe_rotation", p.vo.keyframe_rotation);
+        visit("keyframe_translation", p.vo.keyframe_translation);
+        visit("ba_window_size", p.vo.ba_window_size);
+        visit("ba_iterations", p.vo.ba_iterations);
+        visit("vocabulary_file", p.vo.vocabulary_file);
+        visit("reloc_candidates", p.vo.reloc_candidates);
+        visit("reloc_max_lost_frames", p.vo.reloc_max_lost_frames);
+        visit("profile_csv", p.profile_csv);
+        visit("profile_json", p.profile_json);
+        visit("benchmark_min_fps", p.benchmark_min_fps);
+        visit("benchmark_max_ate", p.benchmark_max_ate);
+    }
+
+    struct ParseVisitor {
+        const map<string, string> &values;
+        ostream &errors;
+        bool ok;
+        size_t found;
+
+        template<typename T>
+        void operator()(const char *key, T &value) {
+            auto it = values.find(key);
+            if (it == values.end())
+                return;
+            found++;
+            if (!parseValue(it->second, value)) {
+                errors << key << ": cannot read \"" << it->second << "\"" << endl;
+                ok = false;
+            }
+        }
+    };
+
+    struct KeyVisitor {
+        set<string> keys;
+
+        template<typename T>
+        void operator()(const char *key, T &) { keys.insert(key); }
+    };
+
+    bool Parameters::parse(const map<string, string> &values, ostream &errors) {
+        ParseVisitor parser{values, errors, true, 0};
+        visitParameters(*this, parser);
+        if (parser.found < values.size()) {
+            KeyVisitor known;
+            visitParameters(*this, known);
+            for (const auto &value:values) {
+                if (known.keys.count(value.first) == 0) {
+                    errors << "unknown parameter " << value.first << endl;
+                    parser.ok = false;
+                }
+            }
+        }
+        return parser.ok;
+    }
+
+    bool Parameters::validate(ostream &errors) const {
+        bool ok = true;
+        auto check = [&](bool valid, const char *message) {
+            if (!valid) {
+                errors << message << endl;
+                ok = false;
+            }
+        };
+        check(decode_threads >= 1 && decode_queue_size >= 1, "decode_threads and decode_queue_size must be positive");
+        check(camera.fx > 0 && camera.fy > 0, "camera.fx and camera.fy must be positive");
+        check(camera.depth_scale > 0, "camera.depth_scale must be positive");
+        check(vo.number_of_features > 0, "number_of_features must be positive");
+        check(vo.scale_factor > 1, "scale_factor must be greater than 1");
+        check(vo.level_pyramid >= 1, "level_pyramid must be at least 1");
+        check(vo.cell_size > 0, "cell_size must be positive");
+        check(vo.min_fast_threshold >= 0 && vo.min_fast_threshold <= vo.fast_threshold,
+              "min_fast_threshold must be between 0 and fast_threshold");
+        check(vo.match_ratio >= 1, "match_ratio must be at least 1");
+        check(vo.match_window > 0, "match_window must be positive");
+        check(vo.max_num_lost >= 0, "max_num_lost must not be negative");
+        check(vo.min_inliers >= 4, "min_inliers must be at least 4, the size of a PnP sample");
+        check(vo.pnp_iterations > 0, "pnp_iterations must be positive");
+        check(vo.pnp_confidence > 0 && vo.pnp_confidence < 1, "pnp_confidence must be in (0, 1)");
+        check(vo.pose_refine_iterations >= 0, "pose_refine_iterations must not be negative");
+        check(vo.map_point_erase_ratio >= 0 && vo.map_point_erase_ratio < 1, "map_point_erase_ratio must be in [0, 1)");
+        check(vo.min_map_matches >= 0 && vo.max_map_points > 0, "min_map_matches and max_map_points must be positive");
+        check(vo.keyframe_rotation >= 0 && vo.keyframe_translation >= 0, "key-frame thresholds must not be negative");
+        check(vo.ba_window_size >= 1 && vo.ba_iterations >= 0, "ba_window_size must be positive");
+        check(vo.reloc_candidates >= 1, "reloc_candidates must be positive");
+        check(vo.reloc_max_lost_frames >= 0, "reloc_max_lost_frames must not be negative");
+        check(benchmark_min_fps >= 0 && benchmark_max_ate >= 0, "benchmark limits must not be negative");
+        return ok;
+    }
+}
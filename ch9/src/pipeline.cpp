@@ -0,0 +1,140 @@
+//
+// Created by Left Thomas on 2017/9/8.
+//
+
+#include "myslam/pipeline.h"
+#include <chrono>
+#include <opencv2/highgui/highgui.hpp>
+
+namespace myslam {
+
+    Pipeline::Pipeline(const VisualOdometry::Ptr &vo, const Camera::Ptr &camera, size_t queue_size,
+                       int num_extractors) : vo_(vo), camera_(camera),
+                                             frame_pool_(4 * queue_size + max(num_extractors, 1) + 4),
+                                             input_queue_(queue_size),
+                                             extract_queue_(queue_size), track_queue_(queue_size),
+                                             result_queue_(queue_size), running_extractors_(0) {
+        num_extractors = max(num_extractors, 1);
+        running_extractors_ = num_extractors;
+        decode_thread_ = std::thread(&Pipeline::decodeLoop, this);
+        for (int i = 0; i < num_extractors; ++i)
+            extract_threads_.emplace_back(&Pipeline::extractLoop, this);
+        track_thread_ = std::thread(&Pipeline::trackLoop, this);
+    }
+
+    Pipeline::~Pipeline() {
+//        unblock every stage, whatever is still in flight is dropped
+        input_queue_.close();
+        extract_queue_.close();
+        track_queue_.close();
+        result_queue_.close();
+        decode_thread_.join();
+        for (std::thread &t:extract_threads_)
+            t.join();
+        track_thread_.join();
+    }
+
+    bool Pipeline::push(double time_stamp, const string &color_file, const string &depth_file) {
+        Input input;
+        input.time_stamp = time_stamp;
+        input.color_file = color_file;
+        input.depth_file = depth_file;
+        return input_queue_.push(std::move(input));
+    }
+
+    bool Pipeline::push(const Frame::Ptr &frame) {
+        Input input;
+        input.time_stamp = frame->time_stamp_;
+        input.frame = frame;
+        return input_queue_.push(std::move(input));
+    }
+
+    void Pipeline::finish() {
+        input_queue_.close();
+    }
+
+    bool Pipeline::pop(Result &result) {
+        return result_queue_.pop(result);
+    }
+
+    void Pipeline::decodeLoop() {
+        unsigned long seq = 0;
+        Input input;
+        while (input_queue_.pop(input)) {
+            Frame::Ptr frame = input.frame;
+            if (frame == nullptr) {
+                Mat color = cv::imread(input.color_file);
+                Mat depth = cv::imread(input.depth_file, -1);
+                if (color.data == nullptr || depth.data == nullptr) {
+                    cerr << "cannot read " << input.color_file << " or " << input.depth_file << endl;
+                    continue;
+                }
+                frame = frame_pool_.acquire();
+                frame->camera_ = camera_;
+                frame->color_ = color;
+                frame->depth_ = depth;
+                frame->time_stamp_ = input.time_stamp;
+            }
+            if (!extract_queue_.push(Job{seq++, frame}))
+                break;
+        }
+        extract_queue_.close();
+    }
+
+    void Pipeline::extractLoop() {
+//        every worker owns its extractor so no state is shared between threads
+        ORBExtractor::Ptr extractor = vo_->createExtractor();
+        Job job;
+        while (extract_queue_.pop(job)) {
+            if (!job.frame->hasFeatures()) {
+                extractor->extract(job.frame->color_, job.frame->keypoints_, job.frame->descriptors_);
+                job.frame->detect_time_ = extractor->detect_time_;
+                job.frame->describe_time_ = extractor->describe_time_;
+            }
+//            the depth preprocessing is done here too, off the tracking thread
+            if (!job.frame->has_depth_map_)
+                job.frame->prepareDepth();
+            if (!track_queue_.push(std::move(job)))
+                break;
+        }
+        if (--running_extractors_ == 0)
+            track_queue_.close();
+    }
+
+    void Pipeline::trackLoop() {
+//        extractors finish out of order, frames are put back in sequence before tracking.
+//        frame seq waits in slot seq % size, the ring only grows if the extractors get that far apart
+        vector<Frame::Ptr> pending(16);
+        unsigned long next_seq = 0;
+        bool delivering = true;
+        Job job;
+        while (delivering && track_queue_.pop(job)) {
+            if (job.seq - next_seq >= pending.size()) {
+                vector<Frame::Ptr> grown(2 * (job.seq - next_seq + 1));
+                for (unsigned long seq = next_seq; seq < next_seq + pending.size(); ++seq)
+                    grown[seq % grown.size()] = std::move(pending[seq % pending.size()]);
+                pending.swap(grown);
+            }
+            pending[job.seq % pending.size()] = std::move(job.frame);
+            for (Frame::Ptr *slot = &pending[next_seq % pending.size()]; delivering && *slot != nullptr;
+                 slot = &pending[next_seq % pending.size()]) {
+                delivering = track(*slot);
+                slot->reset();
+                ++next_seq;
+            }
+        }
+        result_queue_.close();
+    }
+
+    bool Pipeline::track(const Frame::Ptr &frame) {
+        Result result;
+        result.frame = frame;
+        auto t1 = std::chrono::steady_clock::now();
+        result.tracked = vo_->addFrame(frame);
+        auto t2 = std::chrono::steady_clock::now();
+        result.track_time = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        result.timing = vo_->profiler_->records().back();
+        result.state = vo_->state_;
+        return result_queue_.push(std::move(result));
+    }
+}
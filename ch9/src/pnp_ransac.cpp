@@ -0,0 +1,156 @@
+//
+// Created by Left Thomas on 2017/9/13.
+//
+
+#include "myslam/pnp_ransac.h"
+#include <opencv2/calib3d/calib3d.hpp>
+
+namespace myslam {
+//    size of a minimal sample, P3P and a fourth point to pick among its solutions
+    const int SAMPLE_SIZE = 4;
+//    time to compute a hypothesis, in units of the time to verify one point
+    const double MODEL_COST = 200.0;
+
+    PnPRansac::PnPRansac(int max_iterations, double threshold, double confidence) :
+            iterations_(0), rejected_(0), max_iterations_(max_iterations), threshold2_(threshold * threshold),
+            confidence_(confidence), delta_(0.05), epsilon_(0.2), decision_threshold_(1),
+            pts_3d_(nullptr), pts_2d_(nullptr), fx_(0), fy_(0), cx_(0), cy_(0), rng_(0) {}
+
+    void PnPRansac::updateSPRT(double inlier_ratio) {
+        epsilon_ = min(max(inlier_ratio, delta_ + 0.01), 0.99);
+//        optimal threshold of Matas and Chum, A = t_M * C + 1 + log(A) solved by fixed point iteration
+        double C = (1 - delta_) * log((1 - delta_) / (1 - epsilon_)) + delta_ * log(delta_ / epsilon_);
+        double A = MODEL_COST * C + 1;
+        for (int i = 0; i < 10; ++i)
+            A = MODEL_COST * C + 1 + log(A);
+        decision_threshold_ = A;
+    }
+
+    int PnPRansac::countInliers(const SE3 &T_c_w, vector<int> *inliers) const {
+        int count = 0;
+        for (int i = 0; i < pts_3d_->size(); ++i) {
+            Vector3d p_c = T_c_w * (*pts_3d_)[i];
+            if (p_c(2, 0) <= 0)
+                continue;
+            double du = fx_ * p_c(0, 0) / p_c(2, 0) + cx_ - (*pts_2d_)[i](0, 0);
+            double dv = fy_ * p_c(1, 0) / p_c(2, 0) + cy_ - (*pts_2d_)[i](1, 0);
+            if (du * du + dv * dv < threshold2_) {
+                count++;
+                if (inliers)
+                    inliers->push_back(i);
+            }
+        }
+        return count;
+    }
+
+    bool PnPRansac::verify(const SE3 &T_c_w, int &num_inliers) {
+        const double ratio_in = delta_ / epsilon_, ratio_out = (1 - delta_) / (1 - epsilon_);
+        double lambda = 1;
+        num_inliers = 0;
+//        the points are visited in random order, a bad model is usually rejected after a few of them
+        const int n = static_cast<int>(pts_3d_->size());
+        int start = std::uniform_int_distribution<int>(0, n - 1)(rng_);
+        for (int k = 0; k < n; ++k) {
+            int i = (start + k) % n;
+            Vector3d p_c = T_c_w * (*pts_3d_)[i];
+            bool good = false;
+            if (p_c(2, 0) > 0) {
+                double du = fx_ * p_c(0, 0) / p_c(2, 0) + cx_ - (*pts_2d_)[i](0, 0);
+                double dv = fy_ * p_c(1, 0) / p_c(2, 0) + cy_ - (*pts_2d_)[i](1, 0);
+                good = du * du + dv * dv < threshold2_;
+            }
+            if (good) {
+                num_inliers++;
+                lambda *= ratio_in;
+            } else {
+                lambda *= ratio_out;
+            }
+            if (lambda > decision_threshold_)
+                return false;
+        }
+        return true;
+    }
+
+    int PnPRansac::estimate(const vector<Vector3d> &pts_3d, const vector<Vector2d> &pts_2d,
+                            const Camera::Ptr &camera, const SE3 *prior, SE3 &T_c_w, vector<int> &inliers) {
+        iterations_ = 0;
+        rejected_ = 0;
+        inliers.clear();
+        const int n = static_cast<int>(pts_3d.size());
+        if (n < SAMPLE_SIZE)
+            return 0;
+        pts_3d_ = &pts_3d;
+        pts_2d_ = &pts_2d;
+        fx_ = camera->fx_;
+        fy_ = camera->fy_;
+        cx_ = camera->cx_;
+        cy_ = camera->cy_;
+        cv::Mat_<double> K(3, 3);
+        K << fx_, 0, cx_, 0, fy_, cy_, 0, 0, 1;
+
+        updateSPRT(0.2);
+        int best_inliers = 0;
+        SE3 best_pose;
+//        with a good motion prior this is already the answer and the loop below ends right away
+        if (prior != nullptr) {
+            best_inliers = countInliers(*prior, nullptr);
+            best_pose = *prior;
+            if (best_inliers > 0)
+                updateSPRT(double(best_inliers) / n);
+        }
+
+        auto requiredIterations = [&](int num_inliers) {
+            double w = double(num_inliers) / n;
+            double p_good = pow(w, SAMPLE_SIZE);
+            if (p_good >= 1)
+                return 0;
+            if (p_good <= 0)
+                return max_iterations_;
+            return min(max_iterations_, static_cast<int>(ceil(log(1 - confidence_) / log(1 - p_good))));
+        };
+        int needed = requiredIterations(best_inliers);
+
+        vector<cv::Point3f> &sample_3d = sample_3d_;
+        vector<cv::Point2f> &sample_2d = sample_2d_;
+        sample_3d.resize(SAMPLE_SIZE);
+        sample_2d.resize(SAMPLE_SIZE);
+        std::uniform_int_distribution<int> pick(0, n - 1);
+        Mat &rvec = rvec_, &tvec = tvec_;
+        for (; iterations_ < needed; ++iterations_) {
+            int index[SAMPLE_SIZE];
+            for (int s = 0; s < SAMPLE_SIZE; ++s) {
+                bool unique;
+                do {
+                    index[s] = pick(rng_);
+                    unique = true;
+                    for (int t = 0; t < s; ++t)
+                        unique = unique && index[t] != index[s];
+                } while (!unique);
+                const Vector3d &p = pts_3d[index[s]];
+                sample_3d[s] = cv::Point3f(p(0, 0), p(1, 0), p(2, 0));
+                sample_2d[s] = cv::Point2f(pts_2d[index[s]](0, 0), pts_2d[index[s]](1, 0));
+            }
+            if (!cv::solvePnP(sample_3d, sample_2d, K, Mat(), rvec, tvec, false, cv::SOLVEPNP_P3P))
+                continue;
+//            rvec is a Rodrigues vector, SO3(x, y, z) would compose rotations about the axes instead
+            SE3 pose(SO3::exp(Vector3d(rvec.at<double>(0, 0), rvec.at<double>(1, 0), rvec.at<double>(2, 0))),
+                     Vector3d(tvec.at<double>(0, 0), tvec.at<double>(1, 0), tvec.at<double>(2, 0)));
+            int num_inliers;
+            if (!verify(pose, num_inliers)) {
+                rejected_++;
+                continue;
+            }
+            if (num_inliers > best_inliers) {
+                best_inliers = num_inliers;
+                best_pose = pose;
+                updateSPRT(double(best_inliers) / n);
+                needed = requiredIterations(best_inliers);
+            }
+        }
+
+        if (best_inliers == 0)
+            return 0;
+        T_c_w = best_pose;
+        return countInliers(best_pose, &inliers);
+    }
+}
@@ -0,0 +1,92 @@
+//
+// Created by Left Thomas on 2017/9/19.
+//
+
+#include "myslam/pose_publisher.h"
+#include <cstring>
+#include <type_traits>
+
+namespace myslam {
+    static_assert(std::is_trivially_copyable<PoseUpdate>::value, "updates are copied as raw words");
+
+    SE3 PoseUpdate::pose() const {
+        Eigen::Quaterniond q(rotation[3], rotation[0], rotation[1], rotation[2]);
+        return SE3(q, Vector3d(translation[0], translation[1], translation[2]));
+    }
+
+    void PoseUpdate::setPose(const SE3 &T_c_w) {
+        Eigen::Quaterniond q = T_c_w.unit_quaternion();
+        for (int i = 0; i < 3; ++i)
+            translation[i] = T_c_w.translation()(i, 0);
+        rotation[0] = q.x();
+        rotation[1] = q.y();
+        rotation[2] = q.z();
+        rotation[3] = q.w();
+    }
+
+    PosePublisher::PosePublisher(size_t capacity) : capacity_(max<size_t>(capacity, 2)), slots_(new Slot[capacity_]),
+                                                    published_(0) {
+//        no slot holds update n yet for any n
+        for (size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(0, std::memory_order_relaxed);
+            for (size_t w = 0; w < WORDS; ++w)
+                slots_[i].words[w].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void PosePublisher::publish(const PoseUpdate &update) {
+        uint64_t words[WORDS] = {};
+        memcpy(words, &update, sizeof(update));
+        unsigned long n = published_.load(std::memory_order_relaxed);
+        Slot &slot = slots_[n % capacity_];
+        slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+//        the odd sequence is visible before any of the new words
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t w = 0; w < WORDS; ++w)
+            slot.words[w].store(words[w], std::memory_order_relaxed);
+        slot.sequence.store(2 * n + 2, std::memory_order_release);
+        published_.store(n + 1, std::memory_order_release);
+    }
+
+    bool PosePublisher::read(unsigned long n, PoseUpdate &update) const {
+        const Slot &slot = slots_[n % capacity_];
+        unsigned long before = slot.sequence.load(std::memory_order_acquire);
+        if (before != 2 * n + 2)
+            return false;
+        uint64_t words[WORDS];
+        for (size_t w = 0; w < WORDS; ++w)
+            words[w] = slot.words[w].load(std::memory_order_relaxed);
+//        the words are read before the sequence is checked again
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before)
+            return false;
+        memcpy(&update, words, sizeof(update));
+        return true;
+    }
+
+    bool PosePublisher::latest(PoseUpdate &update) const {
+//        fails only if the writer went all around the ring meanwhile, then there is a newer one
+        for (;;) {
+            unsigned long n = published();
+            if (n == 0)
+                return false;
+            if (read(n - 1, update))
+                return true;
+        }
+    }
+
+    bool PosePublisher::next(unsigned long &cursor, PoseUpdate &update) const {
+        for (;;) {
+            unsigned long n = published();
+            if (cursor >= n)
+                return false;
+//            the oldest slot may be the one being overwritten right now
+            if (n - cursor >= capacity_)
+                cursor = n - capacity_ + 1;
+            if (read(cursor, update)) {
+                cursor++;
+                return true;
+            }
+        }
+    }
+}
@@ -0,0 +1,112 @@
+//
+// Created by Left Thomas on 2017/9/14.
+//
+
+#include "myslam/profiler.h"
+#include <fstream>
+#include <algorithm>
+
+namespace myslam {
+
+    const char *Profiler::stageName(Stage stage) {
+        static const char *names[NUM_STAGES] = {"total", "detect", "describe", "ba_update", "match", "pnp",
+                                                "refine", "check", "map", "keyframe", "relocalize"};
+        return names[stage];
+    }
+
+    void Profiler::beginFrame(unsigned long id) {
+        FrameRecord record;
+        record.id = id;
+        fill(record.time, record.time + NUM_STAGES, 0.0);
+        records_.push_back(record);
+    }
+
+    vector<double> Profiler::samples(Stage stage) const {
+        vector<double> values;
+        values.reserve(records_.size());
+        for (const FrameRecord &r:records_) {
+            if (r.time[stage] > 0)
+                values.push_back(r.time[stage]);
+        }
+        return values;
+    }
+
+    static double percentileOf(vector<double> &values, double p) {
+        if (values.empty())
+            return 0;
+//        nearest rank
+        size_t rank = static_cast<size_t>(ceil(p / 100 * values.size()));
+        size_t k = rank > 0 ? rank - 1 : 0;
+        nth_element(values.begin(), values.begin() + k, values.end());
+        return values[k];
+    }
+
+    double Profiler::percentile(Stage stage, double p) const {
+        vector<double> values = samples(stage);
+        return percentileOf(values, p);
+    }
+
+    void Profiler::printSummary(ostream &out) const {
+        out << "stage        frames     mean      p50      p95      p99      max (ms)" << endl;
+        for (int s = 0; s < NUM_STAGES; ++s) {
+            vector<double> values = samples(Stage(s));
+            if (values.empty())
+                continue;
+            double sum = 0;
+            for (double v:values)
+                sum += v;
+            char line[128];
+            double mean = sum / values.size();
+            double p50 = percentileOf(values, 50), p95 = percentileOf(values, 95), p99 = percentileOf(values, 99);
+            double max_value = *max_element(values.begin(), values.end());
+            snprintf(line, sizeof(line), "%-10s %8zu %8.3f %8.3f %8.3f %8.3f %8.3f", stageName(Stage(s)),
+                     values.size(), mean, p50, p95, p99, max_value);
+            out << line << endl;
+        }
+    }
+
+    static bool writeFailed(const string &filename) {
+        cerr << "cannot write profile to " << filename << endl;
+        return false;
+    }
+
+    bool Profiler::writeCSV(const string &filename) const {
+        ofstream fout(filename);
+        if (!fout)
+            return writeFailed(filename);
+        fout << "frame";
+        for (int s = 0; s < NUM_STAGES; ++s)
+            fout << "," << stageName(Stage(s));
+        fout << "\n";
+        for (const FrameRecord &r:records_) {
+            fout << r.id;
+            for (int s = 0; s < NUM_STAGES; ++s)
+                fout << "," << r.time[s];
+            fout << "\n";
+        }
+        return true;
+    }
+
+    bool Profiler::writeJSON(const string &filename) const {
+        ofstream fout(filename);
+        if (!fout)
+            return writeFailed(filename);
+        fout << "{\n  \"summary\": {";
+        for (int s = 0; s < NUM_STAGES; ++s) {
+            vector<double> values = samples(Stage(s));
+            fout << (s ? "," : "") << "\n    \"" << stageName(Stage(s)) << "\": {\"frames\": " << values.size()
+                 << ", \"p50\": " << percentileOf(values, 50) << ", \"p95\": " << percentileOf(values, 95)
+                 << ", \"p99\": " << percentileOf(values, 99) << "}";
+        }
+        fout << "\n  },\n  \"frames\": [";
+        for (int i = 0; i < records_.size(); ++i) {
+            const FrameRecord &r = records_[i];
+            fout << (i ? "," : "") << "\n    {\"id\": " << r.id;
+            for (int s = 0; s < NUM_STAGES; ++s)
+                fout << ", \"" << stageName(Stage(s)) << "\": " << r.time[s];
+            fout << "}";
+        }
+        fout << "\n  ]\n}\n";
+        return true;
+    }
+}
@@ -0,0 +1,117 @@
+//
+// Created by Left Thomas on 2017/9/19.
+//
+
+#include "myslam/relocalizer.h"
+
+#ifdef MYSLAM_USE_DBOW3
+
+#include <DBoW3/DBoW3.h>
+
+#endif
+
+namespace myslam {
+//    hamming distance above which a descriptor match is not trusted, there is no pose to check it against
+    static const float MAX_MATCH_DISTANCE = 50;
+
+#ifdef MYSLAM_USE_DBOW3
+    struct Relocalizer::Index {
+//        the database keeps its own copy of the vocabulary
+        DBoW3::Database database;
+
+        const DBoW3::Vocabulary &vocabulary() const { return *database.getVocabulary(); }
+    };
+#else
+    struct Relocalizer::Index {
+    };
+#endif
+
+    Relocalizer::Relocalizer(const string &vocabulary_file, int num_candidates, int min_inliers) :
+            num_candidates_(max(num_candidates, 1)), min_inliers_(min_inliers) {
+#ifdef MYSLAM_USE_DBOW3
+        DBoW3::Vocabulary vocabulary(vocabulary_file);
+        if (vocabulary.empty()) {
+            cerr << "vocabulary " << vocabulary_file << " does not exist, no relocalization." << endl;
+            return;
+        }
+        index_.reset(new Index);
+//        no direct index, the matching below does not use it
+        index_->database.setVocabulary(vocabulary, false, 0);
+#else
+        cerr << "myslam was built without DBoW3, no relocalization." << endl;
+#endif
+    }
+
+    Relocalizer::~Relocalizer() = default;
+
+    bool Relocalizer::isReady() const {
+        return index_ != nullptr;
+    }
+
+    void Relocalizer::addKeyFrame(const Frame::Ptr &frame) {
+#ifdef MYSLAM_USE_DBOW3
+        if (!isReady())
+            return;
+        KeyFrameEntry entry;
+        entry.frame_id = frame->id_;
+        for (int i = 0; i < frame->map_points_.size(); ++i) {
+            if (frame->map_points_[i] == nullptr)
+                continue;
+            entry.descriptors.push_back(frame->descriptors_.row(i));
+            entry.points.push_back(frame->map_points_[i]);
+        }
+        if (entry.points.size() < min_inliers_)
+            return;
+//        entry ids are given in insertion order, they index keyframes_
+        DBoW3::BowVector words;
+        index_->vocabulary().transform(entry.descriptors, words);
+        index_->database.add(words);
+        keyframes_.push_back(std::move(entry));
+#endif
+    }
+
+    bool Relocalizer::relocalize(const Frame::Ptr &frame, PnPRansac &pnp, SE3 &T_c_w,
+                                 vector<MapPoint::Ptr> &points, vector<int> &keypoint_index) {
+#ifdef MYSLAM_USE_DBOW3
+        if (!isReady() || keyframes_.empty() || frame->descriptors_.rows < min_inliers_)
+            return false;
+        DBoW3::BowVector words;
+        index_->vocabulary().transform(frame->descriptors_, words);
+        DBoW3::QueryResults results;
+        index_->database.query(words, results, num_candidates_);
+
+//        best score first
+        for (const DBoW3::Result &result:results) {
+            const KeyFrameEntry &candidate = keyframes_[result.Id];
+            matcher_.match(candidate.descriptors, frame->descriptors_, matches_);
+            pts_3d_.clear();
+            pts_2d_.clear();
+            for (int i = 0; i < matches_.size(); ++i) {
+                const cv::DMatch &m = matches_[i];
+                if (m.distance > MAX_MATCH_DISTANCE)
+                    continue;
+                matches_[pts_3d_.size()] = m;
+                pts_3d_.push_back(candidate.points[m.queryIdx]->pos_);
+                const cv::Point2f &pt = frame->keypoints_[m.trainIdx].pt;
+                pts_2d_.emplace_back(pt.x, pt.y);
+            }
+            matches_.resize(pts_3d_.size());
+            if (pts_3d_.size() < min_inliers_)
+                continue;
+            int num_inliers = pnp.estimate(pts_3d_, pts_2d_, frame->camera_, nullptr, T_c_w, inliers_);
+            if (num_inliers < min_inliers_)
+                continue;
+            cout << "relocalized against key-frame " << candidate.frame_id << " with " << num_inliers
+                 << " inliers, score " << result.Score << endl;
+            points.clear();
+            keypoint_index.clear();
+            for (int i:inliers_) {
+                points.push_back(candidate.points[matches_[i].queryIdx]);
+                keypoint_index.push_back(matches_[i].trainIdx);
+            }
+            return true;
+        }
+#endif
+        return false;
+    }
+}
@@ -0,0 +1,152 @@
+//
+// Created by Left Thomas on 2017/9/17.
+//
+
+#include "myslam/sequence_pack.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace myslam {
+    static const char PACK_MAGIC[8] = {'M', 'S', 'L', 'P', 'A', 'C', 'K', '1'};
+    static const uint64_t PACK_ALIGNMENT = 64;
+
+    struct PackHeader {
+        char magic[8];
+        uint64_t num_frames;
+        uint64_t index_offset;
+    };
+
+    SequencePackWriter::~SequencePackWriter() {
+        if (file_ != nullptr)
+            close();
+    }
+
+    bool SequencePackWriter::open(const string &filename) {
+        file_ = fopen(filename.c_str(), "wb");
+        if (file_ == nullptr) {
+            cerr << "cannot write " << filename << endl;
+            return false;
+        }
+        entries_.clear();
+//        the header is rewritten with the real counts by close()
+        PackHeader header = {};
+        fwrite(&header, sizeof(header), 1, file_);
+        offset_ = sizeof(header);
+        return true;
+    }
+
+    bool SequencePackWriter::writeBlock(const Mat &image, uint64_t &offset) {
+        static const char zeros[PACK_ALIGNMENT] = {};
+        uint64_t padding = (PACK_ALIGNMENT - offset_ % PACK_ALIGNMENT) % PACK_ALIGNMENT;
+        if (padding > 0 && fwrite(zeros, 1, padding, file_) != padding)
+            return false;
+        offset_ += padding;
+        offset = offset_;
+        size_t row_bytes = image.cols * image.elemSize();
+        for (int y = 0; y < image.rows; ++y) {
+            if (fwrite(image.ptr(y), 1, row_bytes, file_) != row_bytes)
+                return false;
+        }
+        offset_ += row_bytes * image.rows;
+        return true;
+    }
+
+    bool SequencePackWriter::add(double time_stamp, const Mat &color, const Mat &depth, const double *pose) {
+        if (file_ == nullptr || color.type() != CV_8UC3 || depth.type() != CV_16UC1 ||
+            color.size() != depth.size()) {
+            cerr << "a pack frame needs an open file, a BGR image and a 16 bit depth of the same size" << endl;
+            return false;
+        }
+        PackEntry entry = {};
+        entry.time_stamp = time_stamp;
+        entry.width = color.cols;
+        entry.height = color.rows;
+        if (!writeBlock(color, entry.color_offset) || !writeBlock(depth, entry.depth_offset)) {
+            cerr << "cannot write frame at " << time_stamp << endl;
+            return false;
+        }
+        if (pose != nullptr) {
+            entry.has_pose = 1;
+            memcpy(entry.pose, pose, sizeof(entry.pose));
+        }
+        entries_.push_back(entry);
+        return true;
+    }
+
+    bool SequencePackWriter::close() {
+        if (file_ == nullptr)
+            return false;
+        PackHeader header;
+        memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+        header.num_frames = entries_.size();
+        header.index_offset = offset_;
+        bool ok = fwrite(entries_.data(), sizeof(PackEntry), entries_.size(), file_) == entries_.size();
+        ok = ok && fseek(file_, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file_) == 1;
+        ok = fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        return ok;
+    }
+
+    SequencePack::Ptr SequencePack::open(const string &filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            cerr << "cannot open " << filename << endl;
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < sizeof(PackHeader)) {
+            cerr << filename << " is not a sequence pack" << endl;
+            ::close(fd);
+            return nullptr;
+        }
+        size_t length = static_cast<size_t>(st.st_size);
+//        private and writable, a Mat written to by mistake gets its own copy of the page
+        void *data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            cerr << "cannot map " << filename << endl;
+            return nullptr;
+        }
+
+        SequencePack::Ptr pack(new SequencePack);
+        pack->data_ = static_cast<uchar *>(data);
+        pack->length_ = length;
+        const PackHeader *header = reinterpret_cast<const PackHeader *>(data);
+        if (memcmp(header->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 ||
+            header->index_offset + header->num_frames * sizeof(PackEntry) > length) {
+            cerr << filename << " is not a sequence pack" << endl;
+            return nullptr;
+        }
+        pack->num_frames_ = header->num_frames;
+        pack->entries_ = reinterpret_cast<const PackEntry *>(pack->data_ + header->index_offset);
+        for (size_t i = 0; i < pack->num_frames_; ++i) {
+            const PackEntry &e = pack->entries_[i];
+            uint64_t pixels = uint64_t(e.width) * e.height;
+            if (e.color_offset + 3 * pixels > length || e.depth_offset + 2 * pixels > length) {
+                cerr << filename << " is truncated" << endl;
+                return nullptr;
+            }
+        }
+//        the frames are read in order, let the kernel read ahead
+        madvise(pack->data_, length, MADV_SEQUENTIAL);
+        return pack;
+    }
+
+    SequencePack::~SequencePack() {
+        if (data_ != nullptr)
+            munmap(data_, length_);
+    }
+
+    Mat SequencePack::color(size_t i) const {
+        const PackEntry &e = entries_[i];
+        return Mat(e.height, e.width, CV_8UC3, data_ + e.color_offset);
+    }
+
+    Mat SequencePack::depth(size_t i) const {
+        const PackEntry &e = entries_[i];
+        return Mat(e.height, e.width, CV_16UC1, data_ + e.depth_offset);
+    }
+}
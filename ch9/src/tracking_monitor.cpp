@@ -0,0 +1,35 @@
+//
+// Created by Left Thomas on 2017/9/21.
+//
+
+#include "myslam/tracking_monitor.h"
+
+namespace myslam {
+
+    bool TrackingMonitor::update(unsigned long frame_id, VisualOdometry::VOState state) {
+        if (state != VisualOdometry::LOST) {
+            if (was_lost_)
+                relocalized_.push_back(frame_id);
+            was_lost_ = false;
+            lost_in_a_row_ = 0;
+            return true;
+        }
+        was_lost_ = true;
+        lost_frames_++;
+        lost_in_a_row_++;
+        if (!can_relocalize_ || lost_in_a_row_ > max_lost_frames_) {
+            gave_up_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    void TrackingMonitor::printSummary(ostream &out) const {
+        out << "lost frames: " << lost_frames_ << ", relocalized " << relocalized_.size() << " times";
+        for (size_t i = 0; i < relocalized_.size(); ++i)
+            out << (i == 0 ? " at frames " : ", ") << relocalized_[i];
+        out << endl;
+        if (gave_up_)
+            out << (can_relocalize_ ? "vo stayed lost, stopped" : "vo lost without a relocalizer, stopped") << endl;
+    }
+}
@@ -0,0 +1,128 @@
+//
+// Created by Left Thomas on 2017/9/15.
+//
+
+#include "myslam/trajectory.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace myslam {
+
+    bool readTUMTrajectory(const string &filename, Trajectory &trajectory) {
+        trajectory.clear();
+        ifstream fin(filename);
+        if (!fin) {
+            cerr << "cannot read trajectory " << filename << endl;
+            return false;
+        }
+        string line;
+        while (getline(fin, line)) {
+            if (line.empty() || line[0] == '#')
+                continue;
+            istringstream iss(line);
+            double t, tx, ty, tz, qx, qy, qz, qw;
+            if (!(iss >> t >> tx >> ty >> tz >> qx >> qy >> qz >> qw))
+                continue;
+            Eigen::Quaterniond q(qw, qx, qy, qz);
+            q.normalize();
+            trajectory.push_back(StampedPose{t, SE3(q, Vector3d(tx, ty, tz))});
+        }
+        return true;
+    }
+
+    bool writeTUMTrajectory(const string &filename, const Trajectory &trajectory) {
+        ofstream fout(filename);
+        if (!fout) {
+            cerr << "cannot write trajectory " << filename << endl;
+            return false;
+        }
+        fout << fixed << setprecision(9);
+        for (const StampedPose &p:trajectory) {
+            Eigen::Quaterniond q = p.T_w_c.unit_quaternion();
+            const Vector3d &t = p.T_w_c.translation();
+            fout << p.time << " " << t(0, 0) << " " << t(1, 0) << " " << t(2, 0) << " "
+                 << q.x() << " " << q.y() << " " << q.z() << " " << q.w() << "\n";
+        }
+        return true;
+    }
+
+    void associateTrajectories(const Trajectory &estimated, const Trajectory &groundtruth, double max_difference,
+                               Trajectory &matched_estimated, Trajectory &matched_groundtruth) {
+        matched_estimated.clear();
+        matched_groundtruth.clear();
+        if (groundtruth.empty())
+            return;
+        size_t j = 0;
+        for (const StampedPose &e:estimated) {
+//            the groundtruth pose closest in time, both lists are sorted so j only moves forward
+            while (j + 1 < groundtruth.size() &&
+                   fabs(groundtruth[j + 1].time - e.time) <= fabs(groundtruth[j].time - e.time))
+                ++j;
+            if (fabs(groundtruth[j].time - e.time) < max_difference) {
+                matched_estimated.push_back(e);
+                matched_groundtruth.push_back(groundtruth[j]);
+            }
+        }
+    }
+
+    static void fillStatistics(vector<double> &errors, double rot_squared_sum, TrajectoryError &result) {
+        result.pairs = static_cast<int>(errors.size());
+        if (errors.empty())
+            return;
+        double sum = 0, squared_sum = 0;
+        for (double e:errors) {
+            sum += e;
+            squared_sum += e * e;
+        }
+        result.rmse = sqrt(squared_sum / errors.size());
+        result.mean = sum / errors.size();
+        result.max_error = *max_element(errors.begin(), errors.end());
+        nth_element(errors.begin(), errors.begin() + errors.size() / 2, errors.end());
+        result.median = errors[errors.size() / 2];
+        result.rot_rmse = sqrt(rot_squared_sum / errors.size());
+    }
+
+    TrajectoryError computeATE(const Trajectory &estimated, const Trajectory &groundtruth) {
+        TrajectoryError result;
+        const int n = static_cast<int>(min(estimated.size(), groundtruth.size()));
+        if (n < 3)
+            return result;
+        Eigen::Matrix3Xd src(3, n), dst(3, n);
+        for (int i = 0; i < n; ++i) {
+            src.col(i) = estimated[i].T_w_c.translation();
+            dst.col(i) = groundtruth[i].T_w_c.translation();
+        }
+        Eigen::Matrix4d S = Eigen::umeyama(src, dst, false);
+        SE3 T_align(Eigen::Matrix3d(S.block<3, 3>(0, 0)), Vector3d(S.block<3, 1>(0, 3)));
+
+        vector<double> errors(n);
+        double rot_squared_sum = 0;
+        for (int i = 0; i < n; ++i) {
+            SE3 aligned = T_align * estimated[i].T_w_c;
+            errors[i] = (aligned.translation() - groundtruth[i].T_w_c.translation()).norm();
+            double angle = (groundtruth[i].T_w_c.inverse() * aligned).so3().log().norm();
+            rot_squared_sum += angle * angle;
+        }
+        fillStatistics(errors, rot_squared_sum, result);
+        return result;
+    }
+
+    TrajectoryError computeRPE(const Trajectory &estimated, const Trajectory &groundtruth, int delta) {
+        TrajectoryError result;
+        const int n = static_cast<int>(min(estimated.size(), groundtruth.size()));
+        vector<double> errors;
+        double rot_squared_sum = 0;
+        for (int i = 0; i + delta < n; ++i) {
+            SE3 motion_estimated = estimated[i].T_w_c.inverse() * estimated[i + delta].T_w_c;
+            SE3 motion_groundtruth = groundtruth[i].T_w_c.inverse() * groundtruth[i + delta].T_w_c;
+            SE3 error = motion_groundtruth.inverse() * motion_estimated;
+            errors.push_back(error.translation().norm());
+            double angle = error.so3().log().norm();
+            rot_squared_sum += angle * angle;
+        }
+        fillStatistics(errors, rot_squared_sum, result);
+        return result;
+    }
+}
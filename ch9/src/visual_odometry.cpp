@@ -9,48 +9,126 @@
 
 #include "myslam/visual_odometry.h"
 #include "myslam/config.h"
-#include <opencv2/calib3d/calib3d.hpp>
+#include "myslam/projection_jacobian.h"
 
 namespace myslam {
 
-    VisualOdometry::VisualOdometry() : state_(INITIALIZING), ref_(nullptr), curr_(nullptr),
-                                       num_inliers_(0), num_lost_(0) {
-        num_of_features_ = Config::get<int>("number_of_features");
-        scale_factor_ = Config::get<float>("scale_factor");
-        level_pyramid_ = Config::get<int>("level_pyramid");
-        match_ratio_ = Config::get<float>("match_ratio");
-        max_num_lost_ = Config::get<int>("max_num_lost");
-        min_inliers_ = Config::get<int>("min_inliers");
-        orb_ = cv::ORB::create(num_of_features_, scale_factor_, level_pyramid_);
+    VisualOdometry::VisualOdometry() : VisualOdometry(Config::parameters()->vo) {}
+
+    VisualOdometry::VisualOdometry(const VOParameters &parameters) :
+            state_(INITIALIZING), map_(new Map), ref_(nullptr), curr_(nullptr), has_motion_prior_(false),
+            num_inliers_(0), num_lost_(0), profiler_(new Profiler), publisher_(new PosePublisher) {
+        num_of_features_ = parameters.number_of_features;
+        scale_factor_ = parameters.scale_factor;
+        level_pyramid_ = parameters.level_pyramid;
+        cell_size_ = parameters.cell_size;
+        fast_threshold_ = parameters.fast_threshold;
+        min_fast_threshold_ = parameters.min_fast_threshold;
+        ba_window_size_ = parameters.ba_window_size;
+        ba_iterations_ = parameters.ba_iterations;
+        vocabulary_file_ = parameters.vocabulary_file;
+        reloc_candidates_ = parameters.reloc_candidates;
+        applyParameters(parameters);
+        extractor_ = createExtractor();
+        backend_ = Backend::Ptr(new Backend(ba_iterations_));
+        if (!vocabulary_file_.empty()) {
+            relocalizer_ = Relocalizer::Ptr(new Relocalizer(vocabulary_file_, reloc_candidates_, min_inliers_));
+            if (!relocalizer_->isReady())
+                relocalizer_ = nullptr;
+        }
     }
 
     VisualOdometry::~VisualOdometry() = default;
 
+    void VisualOdometry::applyParameters(const VOParameters &parameters) {
+        match_ratio_ = parameters.match_ratio;
+        match_window_ = parameters.match_window;
+        max_num_lost_ = parameters.max_num_lost;
+        min_inliers_ = parameters.min_inliers;
+        pnp_iterations_ = parameters.pnp_iterations;
+        pnp_confidence_ = parameters.pnp_confidence;
+        pose_refine_iterations_ = parameters.pose_refine_iterations;
+        map_point_erase_ratio_ = parameters.map_point_erase_ratio;
+        min_map_matches_ = parameters.min_map_matches;
+        max_map_points_ = parameters.max_map_points;
+        key_frame_min_rot_ = parameters.keyframe_rotation;
+        key_frame_min_trans_ = parameters.keyframe_translation;
+        pnp_ = PnPRansac::Ptr(new PnPRansac(pnp_iterations_, 4.0, pnp_confidence_));
+    }
+
+    void VisualOdometry::updateParameters(const VOParameters &parameters) {
+        std::atomic_store(&pending_parameters_, shared_ptr<const VOParameters>(new VOParameters(parameters)));
+    }
+
     bool VisualOdometry::addFrame(Frame::Ptr frame) {
+//        parameters changed by another thread are taken between two frames
+        shared_ptr<const VOParameters> parameters = std::atomic_exchange(&pending_parameters_,
+                                                                         shared_ptr<const VOParameters>());
+        if (parameters != nullptr)
+            applyParameters(*parameters);
+        profiler_->beginFrame(frame->id_);
+        bool tracked;
+        {
+            Profiler::ScopedTimer timer(*profiler_, Profiler::TOTAL);
+            tracked = trackFrame(frame);
+        }
+        publish(frame, tracked);
+        return tracked;
+    }
+
+    void VisualOdometry::publish(const Frame::Ptr &frame, bool tracked) {
+        PoseUpdate update;
+        update.frame_id = frame->id_;
+        update.time_stamp = frame->time_stamp_;
+        update.setPose(frame->T_c_w_);
+        update.state = state_;
+        update.tracked = tracked;
+        update.num_inliers = num_inliers_;
+        update.num_map_points = static_cast<int32_t>(map_->map_points_.size());
+        update.track_time = profiler_->records().back().time[Profiler::TOTAL];
+        publisher_->publish(update);
+    }
+
+    bool VisualOdometry::trackFrame(const Frame::Ptr &frame) {
         switch (state_) {
             case INITIALIZING: {
                 state_ = OK;
                 curr_ = ref_ = frame;
 //                extract features from first frame
-                extractKeyPoints();
-                computeDescriptors();
-//                computer the 3d position of features on ref frame
-                setRef3DPoints();
+                if (!curr_->hasFeatures())
+                    extractKeyPoints();
+                profiler_->record(Profiler::DETECT, curr_->detect_time_);
+                profiler_->record(Profiler::DESCRIBE, curr_->describe_time_);
+//                the first frame defines the world, all its features with depth become map points
+                match_3dpts_.clear();
+                match_2dkp_index_.clear();
+                addKeyFrame();
                 break;
             }
             case OK: {
+                applyLocalBA();
                 curr_ = frame;
-                extractKeyPoints();
-                computeDescriptors();
+//                predicted pose, used to select the visible map points
+                curr_->T_c_w_ = has_motion_prior_ ? T_c_r_estimated_ * ref_->T_c_w_ : ref_->T_c_w_;
+                if (!curr_->hasFeatures())
+                    extractKeyPoints();
+                profiler_->record(Profiler::DETECT, curr_->detect_time_);
+                profiler_->record(Profiler::DESCRIBE, curr_->describe_time_);
                 featuresMatching();
                 poseEstimationPnP();
+                poseRefinement();
                 if (checkEstimatedPose()) {
-                    curr_->T_c_w_ = T_c_r_estimated_ * ref_->T_c_w_;
+                    curr_->T_c_w_ = T_c_w_estimated_;
+                    optimizeMap();
+                    if (checkKeyFrame())
+                        addKeyFrame();
                     ref_ = curr_;
-                    setRef3DPoints();
                     num_lost_ = 0;
+                    has_motion_prior_ = true;
                 } else {
                     num_lost_++;
+//                    the reference is kept, so the last relative motion no longer predicts the next one
+                    has_motion_prior_ = false;
                     if (num_lost_ > max_num_lost_)
                         state_ = LOST;
                     return false;
@@ -58,73 +136,209 @@ namespace myslam {
                 break;
             }
             case LOST: {
-                cout << "vo has lost." << endl;
+                if (relocalizer_ == nullptr) {
+                    cout << "vo has lost." << endl;
+                    break;
+                }
+                applyLocalBA();
+                curr_ = frame;
+                if (!curr_->hasFeatures())
+                    extractKeyPoints();
+                profiler_->record(Profiler::DETECT, curr_->detect_time_);
+                profiler_->record(Profiler::DESCRIBE, curr_->describe_time_);
+                if (!relocalize())
+                    return false;
                 break;
             }
         }
         return true;
     }
 
-    void VisualOdometry::extractKeyPoints() {
-        orb_->detect(curr_->color_, keypoints_curr_);
+    bool VisualOdometry::relocalize() {
+        Profiler::ScopedTimer timer(*profiler_, Profiler::RELOCALIZE);
+        if (!relocalizer_->relocalize(curr_, *pnp_, T_c_w_estimated_, match_3dpts_, match_2dkp_index_))
+            return false;
+//        the recovered pose is refined like a tracked one, then tracking restarts from this frame.
+//        the local map still holds the points of where the VO got lost, it is rebuilt around the new key-frame
+        num_inliers_ = match_3dpts_.size();
+        ref_ = curr_;
+        poseRefinement();
+        curr_->T_c_w_ = T_c_w_estimated_;
+        optimizeMap();
+        addKeyFrame();
+        T_c_r_estimated_ = SE3();
+        has_motion_prior_ = false;
+        num_lost_ = 0;
+        state_ = OK;
+        return true;
     }
 
-    void VisualOdometry::computeDescriptors() {
-        orb_->compute(curr_->color_, keypoints_curr_, descriptors_curr_);
+    ORBExtractor::Ptr VisualOdometry::createExtractor() const {
+        return ORBExtractor::Ptr(new ORBExtractor(num_of_features_, scale_factor_, level_pyramid_, cell_size_,
+                                                  fast_threshold_, min_fast_threshold_));
     }
 
-    void VisualOdometry::setRef3DPoints() {
-        pts_3d_ref_.clear();
-        descriptors_ref_ = Mat();
-        for (int i = 0; i < keypoints_curr_.size(); ++i) {
-            double d = ref_->findDepth(keypoints_curr_[i]);
-            if (d > 0) {
-                Vector3d p_cam = ref_->camera_->pixel2camera(Vector2d(
-                        keypoints_curr_[i].pt.x, keypoints_curr_[i].pt.y), d);
-                pts_3d_ref_.emplace_back(p_cam(0, 0), p_cam(1, 0), p_cam(2, 0));
-                descriptors_ref_.push_back(descriptors_curr_.row(i));
-            }
-        }
+    void VisualOdometry::extractKeyPoints() {
+        extractor_->extract(curr_->color_, curr_->keypoints_, curr_->descriptors_);
+        curr_->detect_time_ = extractor_->detect_time_;
+        curr_->describe_time_ = extractor_->describe_time_;
     }
 
     void VisualOdometry::featuresMatching() {
-        vector<cv::DMatch> matches;
-        cv::BFMatcher matcher(cv::NORM_HAMMING);
-        matcher.match(descriptors_ref_, descriptors_curr_, matches, cv::noArray());
+        Profiler::ScopedTimer timer(*profiler_, Profiler::MATCH);
+//        select the candidates in the view of the predicted pose
+        vector<MapPoint::Ptr> &candidates = candidates_;
+        vector<cv::Point2f> &predicted = predicted_;
+        vector<cv::DMatch> &matches = matches_;
+        Mat &desp_map = candidate_descriptors_;
+        candidates.clear();
+        predicted.clear();
+//        no rows but the memory is kept
+        if (desp_map.data != nullptr)
+            desp_map.resize(0);
+//        project the whole map in one batch, the buffers only grow
+        long n = map_->map_points_.size();
+        if (map_positions_.cols() < n) {
+            map_positions_.resize(3, 2 * n);
+            map_cameras_.resize(3, 2 * n);
+            map_pixels_.resize(2, 2 * n);
+        }
+        long i = 0;
+        for (auto &allpoints:map_->map_points_)
+            map_positions_.col(i++) = allpoints.second->pos_;
+        curr_->camera_->world2camera(map_positions_.leftCols(n), curr_->T_c_w_, map_cameras_.leftCols(n));
+        curr_->camera_->camera2pixel(map_cameras_.leftCols(n), map_pixels_.leftCols(n));
+//        same test as Frame::isInFrame
+        i = 0;
+        for (auto &allpoints:map_->map_points_) {
+            double u = map_pixels_(0, i), v = map_pixels_(1, i);
+            if (map_cameras_(2, i++) >= 0 && u > 0 && v > 0 && u < curr_->color_.cols && v < curr_->color_.rows) {
+                MapPoint::Ptr &p = allpoints.second;
+                p->visible_times_++;
+                candidates.push_back(p);
+                desp_map.push_back(p->descriptor_);
+                predicted.emplace_back(u, v);
+            }
+        }
+
+//        with a motion prior the prediction is good enough to search only around it
+        if (has_motion_prior_)
+            matcher_.matchInWindow(desp_map, predicted, curr_->keypoints_, curr_->descriptors_, match_window_, matches);
+//        no prior, or the prediction was off: compare everything
+        else
+            matches.clear();
+        if (matches.size() < 2 * min_inliers_)
+            matcher_.match(desp_map, curr_->descriptors_, matches);
 
+        match_3dpts_.clear();
+        match_2dkp_index_.clear();
+        if (matches.empty())
+            return;
         float min_dist = min_element(matches.begin(), matches.end(), [](
                 const cv::DMatch &m1, const cv::DMatch &m2) {
             return m1.distance < m2.distance;
         })->distance;
 
-        features_matches_.clear();
         for (cv::DMatch &m:matches) {
             if (m.distance < max<float>(match_ratio_ * min_dist, 30.0)) {
-                features_matches_.push_back(m);
+                match_3dpts_.push_back(candidates[m.queryIdx]);
+                match_2dkp_index_.push_back(m.trainIdx);
             }
         }
-//        cout<<"good matches:"<<features_matches_.size()<<endl;
+//        cout<<"good matches:"<<match_3dpts_.size()<<endl;
     }
 
     void VisualOdometry::poseEstimationPnP() {
-        vector<cv::Point3f> pts_3d;
-        vector<cv::Point2f> pts_2d;
-        for (cv::DMatch &m:features_matches_) {
-            pts_3d.push_back(pts_3d_ref_[m.queryIdx]);
-            pts_2d.push_back(keypoints_curr_[m.trainIdx].pt);
+        Profiler::ScopedTimer timer(*profiler_, Profiler::PNP);
+        vector<Vector3d> &pts_3d = pnp_points_;
+        vector<Vector2d> &pts_2d = pnp_pixels_;
+        vector<int> &inliers = pnp_inliers_;
+        pts_3d.clear();
+        pts_2d.clear();
+        for (int i = 0; i < match_3dpts_.size(); ++i) {
+            pts_3d.push_back(match_3dpts_[i]->pos_);
+            const cv::Point2f &pt = curr_->keypoints_[match_2dkp_index_[i]].pt;
+            pts_2d.emplace_back(pt.x, pt.y);
         }
 
-        cv::Mat_<double> K(3, 3);
-        K << ref_->camera_->fx_, 0, ref_->camera_->cx_, 0, ref_->camera_->fy_, ref_->camera_->cy_, 0, 0, 1;
-        Mat rvec, tvec, inliers;
-        cv::solvePnPRansac(pts_3d, pts_2d, K, Mat(), rvec, tvec, false, 100, 4.0, 0.99, inliers);
-        num_inliers_ = inliers.rows;
-//        cout<<"PnP inliers: "<<num_inliers_<<endl;
-        T_c_r_estimated_ = SE3(SO3(rvec.at<double>(0, 0), rvec.at<double>(1, 0), rvec.at<double>(2, 0)),
-                               Vector3d(tvec.at<double>(0, 0), tvec.at<double>(1, 0), tvec.at<double>(2, 0)));
+//        the constant velocity prediction is the first hypothesis
+        num_inliers_ = pnp_->estimate(pts_3d, pts_2d, curr_->camera_, has_motion_prior_ ? &curr_->T_c_w_ : nullptr,
+                                      T_c_w_estimated_, inliers);
+//        cout<<"PnP inliers: "<<num_inliers_<<" after "<<pnp_->iterations_<<" iterations"<<endl;
+        if (num_inliers_ == 0)
+            return;
+//        only the inliers are kept as matches, they become the observations of a new key-frame
+        for (int i = 0; i < inliers.size(); ++i) {
+            int index = inliers[i];
+            match_3dpts_[index]->matched_times_++;
+            match_3dpts_[i] = match_3dpts_[index];
+            match_2dkp_index_[i] = match_2dkp_index_[index];
+        }
+        match_3dpts_.resize(inliers.size());
+        match_2dkp_index_.resize(inliers.size());
+        T_c_r_estimated_ = T_c_w_estimated_ * ref_->T_c_w_.inverse();
+    }
+
+    void VisualOdometry::poseRefinement() {
+        Profiler::ScopedTimer timer(*profiler_, Profiler::REFINE);
+        if (num_inliers_ < 4)
+            return;
+        typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+        const double huber_delta = 2.0;
+        const double fx = curr_->camera_->fx_, fy = curr_->camera_->fy_;
+        const double cx = curr_->camera_->cx_, cy = curr_->camera_->cy_;
+//        huber cost of the matches at T with the normal equations linearized there,
+//        the matches are visited in place with fixed-size normal equations.
+//        matches behind the camera have no cost, in_front tells which ones it covers
+        auto evaluate = [&](const SE3 &T, Matrix6d &H, Sophus::Vector6d &b, vector<char> &in_front) -> double {
+            H.setZero();
+            b.setZero();
+            in_front.resize(match_3dpts_.size());
+            double cost = 0;
+            for (int i = 0; i < match_3dpts_.size(); ++i) {
+                Vector3d p_c = T * match_3dpts_[i]->pos_;
+                in_front[i] = p_c(2, 0) > 0;
+                if (!in_front[i])
+                    continue;
+                const cv::Point2f &pt = curr_->keypoints_[match_2dkp_index_[i]].pt;
+                Vector2d e(fx * p_c(0, 0) / p_c(2, 0) + cx - pt.x, fy * p_c(1, 0) / p_c(2, 0) + cy - pt.y);
+                double norm = e.norm();
+                double w = norm <= huber_delta ? 1.0 : huber_delta / norm;
+                cost += norm <= huber_delta ? norm * norm : 2 * huber_delta * norm - huber_delta * huber_delta;
+                Eigen::Matrix<double, 2, 6> J = jacobianPixelToPose(p_c, fx, fy);
+                H.noalias() += w * J.transpose() * J;
+                b.noalias() -= w * J.transpose() * e;
+            }
+            return cost;
+        };
+        SE3 T = T_c_w_estimated_;
+        Matrix6d H, H_new;
+        Sophus::Vector6d b, b_new;
+        double cost = evaluate(T, H, b, refine_in_front_);
+//        every step is evaluated and kept only if it lowers the cost, so the last one counts as well.
+//        a step moving matches across the camera plane changes what the cost covers and is rejected too
+        for (int iter = 0; iter < pose_refine_iterations_; ++iter) {
+            Sophus::Vector6d dx = H.ldlt().solve(b);
+            if (!dx.allFinite())
+                break;
+            SE3 T_new = SE3::exp(dx) * T;
+            double new_cost = evaluate(T_new, H_new, b_new, refine_in_front_new_);
+            if (new_cost >= cost || refine_in_front_new_ != refine_in_front_)
+                break;
+            refine_in_front_.swap(refine_in_front_new_);
+            T = T_new;
+            cost = new_cost;
+            H = H_new;
+            b = b_new;
+            if (dx.norm() < 1e-6)
+                break;
+        }
+        T_c_w_estimated_ = T;
+        T_c_r_estimated_ = T_c_w_estimated_ * ref_->T_c_w_.inverse();
     }
 
     bool VisualOdometry::checkEstimatedPose() {
+        Profiler::ScopedTimer timer(*profiler_, Profiler::CHECK);
         if (num_inliers_ < min_inliers_) {
             cout << "reject because the number of inliers is too small: " << num_inliers_ << endl;
             return false;
@@ -136,4 +350,164 @@ namespace myslam {
         }
         return true;
     }
-}
\ No newline at end of file
+
+    void VisualOdometry::optimizeMap() {
+        Profiler::ScopedTimer timer(*profiler_, Profiler::MAP);
+//        points out of view, rarely matched or seen from a too different angle are removed,
+//        key-frames may still hold them, so they are flagged as well
+        double erase_ratio = map_->map_points_.size() > max_map_points_ ? 2 * map_point_erase_ratio_
+                                                                        : map_point_erase_ratio_;
+        for (auto iter = map_->map_points_.begin(); iter != map_->map_points_.end();) {
+            MapPoint::Ptr &p = iter->second;
+            if (!p->good_ || !curr_->isInFrame(p->pos_) ||
+                double(p->matched_times_) / p->visible_times_ < erase_ratio ||
+                getViewAngle(curr_, p) > M_PI / 6) {
+                p->good_ = false;
+                iter = map_->map_points_.erase(iter);
+                continue;
+            }
+            ++iter;
+        }
+//        cout<<"map points: "<<map_->map_points_.size()<<endl;
+    }
+
+    bool VisualOdometry::checkKeyFrame() {
+        if (match_2dkp_index_.size() < min_map_matches_)
+            return true;
+        SE3 T_c_k = curr_->T_c_w_ * local_keyframes_.back()->T_c_w_.inverse();
+        Sophus::Vector6d d = T_c_k.log();
+        Vector3d trans = d.head<3>();
+        Vector3d rot = d.tail<3>();
+        return rot.norm() > key_frame_min_rot_ || trans.norm() > key_frame_min_trans_;
+    }
+
+    void VisualOdometry::addKeyFrame() {
+        Profiler::ScopedTimer timer(*profiler_, Profiler::KEYFRAME);
+        map_->insertKeyFrame(curr_);
+        curr_->map_points_.assign(curr_->keypoints_.size(), nullptr);
+        for (int i = 0; i < match_3dpts_.size(); ++i) {
+            curr_->map_points_[match_2dkp_index_[i]] = match_3dpts_[i];
+            match_3dpts_[i]->observed_times_++;
+        }
+//        new landmarks only come from key-frames
+        addMapPoints();
+        if (relocalizer_ != nullptr)
+            relocalizer_->addKeyFrame(curr_);
+
+        local_keyframes_.push_back(curr_);
+//        a key-frame leaving the window is dropped from the map too, with its images and descriptors,
+//        a late BA result for it is then skipped by applyLocalBA
+        while (local_keyframes_.size() > ba_window_size_) {
+            map_->eraseKeyFrame(local_keyframes_.front()->id_);
+            local_keyframes_.pop_front();
+        }
+        if (local_keyframes_.size() > 1)
+            submitLocalBA();
+    }
+
+    void VisualOdometry::addMapPoints() {
+//        only the keypoints that are not already a map point
+        vector<bool> matched(curr_->keypoints_.size(), false);
+        for (int index:match_2dkp_index_)
+            matched[index] = true;
+        Vector3d center = curr_->getCameraCenter();
+//        back-project every new point with depth in one batch
+        vector<int> &indices = new_point_indices_;
+        indices.clear();
+        Points2 pixels(2, curr_->keypoints_.size());
+        Eigen::RowVectorXd depths(curr_->keypoints_.size());
+        for (int i = 0; i < curr_->keypoints_.size(); ++i) {
+            if (matched[i])
+                continue;
+            double d = curr_->findDepth(curr_->keypoints_[i]);
+            if (d < 0)
+                continue;
+            pixels.col(indices.size()) = Vector2d(curr_->keypoints_[i].pt.x, curr_->keypoints_[i].pt.y);
+            depths(indices.size()) = d;
+            indices.push_back(i);
+        }
+        long num_new = indices.size();
+        Points3 points(3, num_new);
+        curr_->camera_->pixel2world(pixels.leftCols(num_new), depths.head(num_new), curr_->T_c_w_, points);
+        for (long k = 0; k < num_new; ++k) {
+            int i = indices[k];
+            Vector3d p_world = points.col(k);
+            Vector3d n = p_world - center;
+            n.normalize();
+            MapPoint::Ptr map_point = MapPoint::createMapPoint(p_world, n, curr_->descriptors_.row(i).clone());
+            map_->insertMapPoint(map_point);
+            if (curr_->is_key_frame_) {
+                curr_->map_points_[i] = map_point;
+                map_point->observed_times_++;
+            }
+        }
+    }
+
+    void VisualOdometry::submitLocalBA() {
+        BAProblem::Ptr problem(new BAProblem);
+        const Camera::Ptr &camera = curr_->camera_;
+        problem->fx = camera->fx_;
+        problem->fy = camera->fy_;
+        problem->cx = camera->cx_;
+        problem->cy = camera->cy_;
+//        only the landmarks seen by at least two key-frames of the window constrain it
+        unordered_map<unsigned long, int> num_obs;
+        for (const Frame::Ptr &kf:local_keyframes_) {
+            for (const MapPoint::Ptr &p:kf->map_points_) {
+                if (p != nullptr && p->good_)
+                    num_obs[p->id_]++;
+            }
+        }
+        unordered_map<unsigned long, int> point_index;
+        for (int f = 0; f < local_keyframes_.size(); ++f) {
+            const Frame::Ptr &kf = local_keyframes_[f];
+            problem->keyframe_ids.push_back(kf->id_);
+            problem->poses.push_back(kf->T_c_w_);
+            problem->fixed.push_back(f == 0);
+            for (int i = 0; i < kf->map_points_.size(); ++i) {
+                const MapPoint::Ptr &p = kf->map_points_[i];
+                if (p == nullptr || !p->good_ || num_obs[p->id_] < 2)
+                    continue;
+                auto it = point_index.find(p->id_);
+                if (it == point_index.end()) {
+                    it = point_index.insert(make_pair(p->id_, static_cast<int>(problem->points.size()))).first;
+                    problem->point_ids.push_back(p->id_);
+                    problem->points.push_back(p->pos_);
+                }
+                const cv::Point2f &pt = kf->keypoints_[i].pt;
+                problem->observations.push_back(BAProblem::Observation{f, it->second, Vector2d(pt.x, pt.y)});
+            }
+        }
+        if (!problem->observations.empty())
+            backend_->submit(problem);
+    }
+
+    void VisualOdometry::applyLocalBA() {
+        Profiler::ScopedTimer timer(*profiler_, Profiler::BA_UPDATE);
+        BAResult::Ptr result = backend_->takeResult();
+        if (result == nullptr)
+            return;
+//        the reference frame keeps its pose relative to the newest key-frame
+        const Frame::Ptr &last_kf = local_keyframes_.back();
+        SE3 T_r_k = ref_->T_c_w_ * last_kf->T_c_w_.inverse();
+        for (int i = 0; i < result->keyframe_ids.size(); ++i) {
+            auto it = map_->keyframes_.find(result->keyframe_ids[i]);
+            if (it != map_->keyframes_.end())
+                it->second->T_c_w_ = result->poses[i];
+        }
+        for (int i = 0; i < result->point_ids.size(); ++i) {
+            auto it = map_->map_points_.find(result->point_ids[i]);
+            if (it != map_->map_points_.end())
+                it->second->pos_ = result->points[i];
+        }
+        if (!ref_->is_key_frame_)
+            ref_->T_c_w_ = T_r_k * last_kf->T_c_w_;
+//        cout<<"local BA: "<<result->initial_cost<<" -> "<<result->final_cost<<" in "<<result->time<<" ms"<<endl;
+    }
+
+    double VisualOdometry::getViewAngle(const Frame::Ptr &frame, const MapPoint::Ptr &point) {
+        Vector3d n = point->pos_ - frame->getCameraCenter();
+        n.normalize();
+        return acos(n.transpose() * point->norm_);
+    }
+}
@@ -0,0 +1,163 @@
+//
+// Created by Left Thomas on 2017/9/15.
+// replays a TUM sequence as fast as possible without any window,
+// writes the estimated trajectory and reports speed and accuracy
+//
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include "myslam/config.h"
+#include "myslam/visual_odometry.h"
+#include "myslam/pipeline.h"
+#include "myslam/frame_pool.h"
+#include "myslam/trajectory.h"
+#include "myslam/tracking_monitor.h"
+#include "myslam/dataset_reader.h"
+#include "myslam/sequence_pack.h"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    vector<string> args;
+    vector<string> overrides = myslam::Config::overridesFromArgs(argc, argv, 1, &args);
+    if (args.empty() || args.size() > 3) {
+        cout << "usage: benchmark_vo parameter_file [groundtruth_file] [trajectory_output] [key=value ...]" << endl;
+        return 1;
+    }
+    if (!myslam::Config::setParameterFile(args[0], overrides))
+        return 1;
+    myslam::Parameters::ConstPtr parameters = myslam::Config::parameters();
+    myslam::VisualOdometry::Ptr vo(new myslam::VisualOdometry);
+
+    string dataset_dir = parameters->dataset_dir;
+    string dataset_pack = parameters->dataset_pack;
+    string groundtruth_file = args.size() > 1 ? args[1] : dataset_dir + "/groundtruth.txt";
+    string trajectory_file = args.size() > 2 ? args[2] : "trajectory.txt";
+
+//    a pack made by pack_sequence is replayed straight from memory, otherwise the PNGs are decoded
+    myslam::SequencePack::Ptr pack;
+    shared_ptr<myslam::DatasetReader> reader;
+    if (!dataset_pack.empty()) {
+        pack = myslam::SequencePack::open(dataset_pack);
+        if (pack == nullptr)
+            return 1;
+        cout << "read total " << pack->size() << " frames from " << dataset_pack << endl;
+    } else {
+        reader.reset(new myslam::DatasetReader(dataset_dir, parameters->decode_threads,
+                                               parameters->decode_queue_size));
+        if (!reader->isOpened()) {
+            cout << "please generate the associate file called associate.txt!" << endl;
+            return 1;
+        }
+        cout << "read total " << reader->size() << " entries" << endl;
+    }
+
+    myslam::Camera::Ptr camera(new myslam::Camera());
+    myslam::Pipeline::Ptr pipeline(new myslam::Pipeline(vo, camera));
+    auto start = chrono::steady_clock::now();
+    thread feeder([&] {
+//        more frames than the pipeline queues can hold, so a free one is always found
+        myslam::FramePool pool(64);
+        double time_stamp;
+        Mat color, depth;
+        myslam::DatasetReader::Image image;
+        for (size_t i = 0;; ++i) {
+            if (pack != nullptr) {
+                if (i >= pack->size())
+                    break;
+                time_stamp = pack->entry(i).time_stamp;
+                color = pack->color(i);
+                depth = pack->depth(i);
+            } else {
+                if (!reader->next(image))
+                    break;
+                if (image.color.empty())
+                    continue;
+                time_stamp = image.time_stamp;
+                color = image.color;
+                depth = image.depth;
+            }
+            myslam::Frame::Ptr frame = pool.acquire();
+            frame->camera_ = camera;
+            frame->time_stamp_ = time_stamp;
+            frame->color_ = color;
+            frame->depth_ = depth;
+            if (!pipeline->push(frame))
+                break;
+        }
+        pipeline->finish();
+    });
+
+//    every tracked frame is part of the trajectory, frames rejected by the VO are left out
+    myslam::Trajectory estimated;
+    int num_frames = 0, num_tracked = 0;
+    myslam::TrackingMonitor monitor(vo->relocalizer_ != nullptr, parameters->vo.reloc_max_lost_frames);
+    myslam::Pipeline::Result result;
+    while (pipeline->pop(result)) {
+        num_frames++;
+        if (!monitor.update(result.frame->id_, result.state)) {
+            cout << "vo lost at frame " << result.frame->id_ << endl;
+            break;
+        }
+        if (result.tracked) {
+            num_tracked++;
+            estimated.push_back(myslam::StampedPose{result.frame->time_stamp_, result.frame->T_c_w_.inverse()});
+        }
+    }
+    pipeline->finish();
+    feeder.join();
+    pipeline.reset();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double fps = num_frames / seconds;
+
+    cout << "frames: " << num_frames << ", tracked: " << num_tracked << ", time: " << seconds << " s, "
+         << fps << " frames/s" << endl;
+    monitor.printSummary(cout);
+    vo->profiler_->printSummary(cout);
+    myslam::writeTUMTrajectory(trajectory_file, estimated);
+    cout << "trajectory written to " << trajectory_file << endl;
+
+    bool passed = true;
+    double min_fps = parameters->benchmark_min_fps;
+    if (min_fps > 0 && fps < min_fps) {
+        cout << "FAIL: " << fps << " frames/s is below " << min_fps << endl;
+        passed = false;
+    }
+
+    myslam::Trajectory groundtruth, matched_estimated, matched_groundtruth;
+    bool has_groundtruth = false;
+    if (pack != nullptr && args.size() <= 1) {
+        for (size_t i = 0; i < pack->size(); ++i) {
+            const myslam::PackEntry &e = pack->entry(i);
+            if (e.has_pose)
+                groundtruth.push_back(myslam::StampedPose{e.time_stamp, SE3(
+                        Eigen::Quaterniond(e.pose[6], e.pose[3], e.pose[4], e.pose[5]),
+                        Vector3d(e.pose[0], e.pose[1], e.pose[2]))});
+        }
+        has_groundtruth = !groundtruth.empty();
+    } else {
+        has_groundtruth = myslam::readTUMTrajectory(groundtruth_file, groundtruth);
+    }
+    if (has_groundtruth) {
+        myslam::associateTrajectories(estimated, groundtruth, 0.02, matched_estimated, matched_groundtruth);
+        myslam::TrajectoryError ate = myslam::computeATE(matched_estimated, matched_groundtruth);
+        myslam::TrajectoryError rpe = myslam::computeRPE(matched_estimated, matched_groundtruth);
+        cout << "ATE over " << ate.pairs << " poses: rmse " << ate.rmse << " m, mean " << ate.mean
+             << " m, median " << ate.median << " m, max " << ate.max_error << " m" << endl;
+        cout << "RPE over " << rpe.pairs << " pairs: rmse " << rpe.rmse << " m, " << rpe.rot_rmse * 180 / M_PI
+             << " deg" << endl;
+        double max_ate = parameters->benchmark_max_ate;
+        if (max_ate > 0 && (ate.pairs == 0 || ate.rmse > max_ate)) {
+            cout << "FAIL: ATE rmse " << ate.rmse << " m is above " << max_ate << " m" << endl;
+            passed = false;
+        }
+    }
+
+    const string &profile_csv = parameters->profile_csv;
+    const string &profile_json = parameters->profile_json;
+    if (!profile_csv.empty())
+        vo->profiler_->writeCSV(profile_csv);
+    if (!profile_json.empty())
+        vo->profiler_->writeJSON(profile_json);
+    return passed ? 0 : 2;
+}
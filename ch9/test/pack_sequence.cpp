@@ -0,0 +1,64 @@
+//
+// Created by Left Thomas on 2017/9/17.
+// packs a TUM sequence into one file for benchmark_vo, see sequence_pack.h
+//
+#include <iostream>
+#include "myslam/dataset_reader.h"
+#include "myslam/sequence_pack.h"
+#include "myslam/trajectory.h"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        cout << "usage: pack_sequence dataset_dir output_file [groundtruth_file]" << endl;
+        return 1;
+    }
+    string dataset_dir = argv[1];
+    myslam::DatasetReader reader(dataset_dir, 4);
+    if (!reader.isOpened())
+        return 1;
+
+//    groundtruth.txt of the sequence is used when it exists
+    myslam::Trajectory groundtruth;
+    string groundtruth_file = argc > 3 ? argv[3] : dataset_dir + "/groundtruth.txt";
+    if (myslam::readTUMTrajectory(groundtruth_file, groundtruth))
+        cout << "groundtruth: " << groundtruth.size() << " poses" << endl;
+
+    myslam::SequencePackWriter writer;
+    if (!writer.open(argv[2]))
+        return 1;
+    int num_frames = 0, num_poses = 0;
+    size_t j = 0;
+    myslam::DatasetReader::Image image;
+    while (reader.next(image)) {
+        if (image.color.empty())
+            continue;
+//        nearest groundtruth pose within 20 ms, as associate.py does
+        const double *pose = nullptr;
+        double values[7];
+        while (j + 1 < groundtruth.size() &&
+               fabs(groundtruth[j + 1].time - image.time_stamp) <= fabs(groundtruth[j].time - image.time_stamp))
+            ++j;
+        if (!groundtruth.empty() && fabs(groundtruth[j].time - image.time_stamp) < 0.02) {
+            const SE3 &T = groundtruth[j].T_w_c;
+            Eigen::Quaterniond q = T.unit_quaternion();
+            values[0] = T.translation()(0, 0);
+            values[1] = T.translation()(1, 0);
+            values[2] = T.translation()(2, 0);
+            values[3] = q.x();
+            values[4] = q.y();
+            values[5] = q.z();
+            values[6] = q.w();
+            pose = values;
+            num_poses++;
+        }
+        if (!writer.add(image.time_stamp, image.color, image.depth, pose))
+            return 1;
+        num_frames++;
+    }
+    if (!writer.close())
+        return 1;
+    cout << "packed " << num_frames << " frames, " << num_poses << " with groundtruth, into " << argv[2] << endl;
+    return 0;
+}
@@ -0,0 +1,229 @@
+//
+// Created by Left Thomas on 2017/9/19.
+// runs the VO over one sequence with many parameter sets in parallel and tabulates speed and accuracy.
+// every line of the sweep file is one or more key=value overrides, a value list key=a,b,c expands the
+// line into one run per value, so "number_of_features=300,500 match_ratio=1.5,2" gives four runs
+//
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "myslam/config.h"
+#include "myslam/visual_odometry.h"
+#include "myslam/frame_pool.h"
+#include "myslam/trajectory.h"
+#include "myslam/tracking_monitor.h"
+#include "myslam/dataset_reader.h"
+#include "myslam/sequence_pack.h"
+
+using namespace std;
+
+//    the whole sequence in memory, shared read-only by all runs
+struct Sequence {
+    vector<double> time_stamps;
+    vector<Mat> colors, depths;
+    myslam::Trajectory groundtruth;
+};
+
+struct Run {
+    vector<string> overrides;
+    string label;
+    myslam::Parameters::ConstPtr parameters;
+    int frames = 0, tracked = 0, relocalized = 0;
+    bool lost = false;
+    double seconds = 0, mean_ms = 0, p95_ms = 0;
+    myslam::TrajectoryError ate, rpe;
+};
+
+static bool loadSequence(const myslam::Parameters &parameters, Sequence &sequence) {
+    if (!parameters.dataset_pack.empty()) {
+//        the Mats point into the mapping, which lives as long as the process
+        static myslam::SequencePack::Ptr pack;
+        pack = myslam::SequencePack::open(parameters.dataset_pack);
+        if (pack == nullptr)
+            return false;
+        for (size_t i = 0; i < pack->size(); ++i) {
+            const myslam::PackEntry &e = pack->entry(i);
+            sequence.time_stamps.push_back(e.time_stamp);
+            sequence.colors.push_back(pack->color(i));
+            sequence.depths.push_back(pack->depth(i));
+            if (e.has_pose)
+                sequence.groundtruth.push_back(myslam::StampedPose{e.time_stamp, SE3(
+                        Eigen::Quaterniond(e.pose[6], e.pose[3], e.pose[4], e.pose[5]),
+                        Vector3d(e.pose[0], e.pose[1], e.pose[2]))});
+        }
+        return true;
+    }
+    myslam::DatasetReader reader(parameters.dataset_dir, parameters.decode_threads, parameters.decode_queue_size);
+    if (!reader.isOpened())
+        return false;
+    myslam::DatasetReader::Image image;
+    while (reader.next(image)) {
+        if (image.color.empty())
+            continue;
+        sequence.time_stamps.push_back(image.time_stamp);
+        sequence.colors.push_back(image.color);
+        sequence.depths.push_back(image.depth);
+    }
+    myslam::readTUMTrajectory(parameters.dataset_dir + "/groundtruth.txt", sequence.groundtruth);
+    return true;
+}
+
+//    every line of the file becomes the runs of the cartesian product of its value lists
+static bool readSweep(const string &filename, vector<Run> &runs) {
+    ifstream fin(filename);
+    if (!fin) {
+        cerr << "cannot read " << filename << endl;
+        return false;
+    }
+    string line;
+    while (getline(fin, line)) {
+        line = line.substr(0, line.find('#'));
+        istringstream iss(line);
+        vector<pair<string, vector<string>>> choices;
+        string token;
+        while (iss >> token) {
+            size_t eq = token.find('=');
+            if (eq == string::npos) {
+                cerr << "expected key=value instead of " << token << endl;
+                return false;
+            }
+            vector<string> values;
+            istringstream list(token.substr(eq + 1));
+            string value;
+            while (getline(list, value, ','))
+                values.push_back(value);
+            if (values.empty())
+                values.push_back("");
+            choices.emplace_back(token.substr(0, eq), values);
+        }
+        if (choices.empty())
+            continue;
+        vector<size_t> pick(choices.size(), 0);
+        for (;;) {
+            Run run;
+            for (size_t k = 0; k < choices.size(); ++k) {
+                run.overrides.push_back(choices[k].first + "=" + choices[k].second[pick[k]]);
+                run.label += (k > 0 ? " " : "") + run.overrides.back();
+            }
+            runs.push_back(run);
+//            next combination, the last key changes fastest
+            size_t k = choices.size();
+            while (k > 0 && ++pick[k - 1] == choices[k - 1].second.size())
+                pick[--k] = 0;
+            if (k == 0)
+                break;
+        }
+    }
+    return true;
+}
+
+static void runSession(const Sequence &sequence, Run &run) {
+    const myslam::Parameters &parameters = *run.parameters;
+    myslam::VisualOdometry::Ptr vo(new myslam::VisualOdometry(parameters.vo));
+    myslam::Camera::Ptr camera(new myslam::Camera(parameters.camera));
+    myslam::FramePool pool;
+    myslam::Trajectory estimated;
+    myslam::TrackingMonitor monitor(vo->relocalizer_ != nullptr, parameters.vo.reloc_max_lost_frames);
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < sequence.colors.size(); ++i) {
+        myslam::Frame::Ptr frame = pool.acquire();
+        frame->camera_ = camera;
+        frame->time_stamp_ = sequence.time_stamps[i];
+        frame->color_ = sequence.colors[i];
+        frame->depth_ = sequence.depths[i];
+        bool tracked = vo->addFrame(frame);
+        run.frames++;
+        if (!monitor.update(frame->id_, vo->state_)) {
+            run.lost = true;
+            break;
+        }
+        if (tracked) {
+            run.tracked++;
+            estimated.push_back(myslam::StampedPose{frame->time_stamp_, frame->T_c_w_.inverse()});
+        }
+    }
+    run.relocalized = static_cast<int>(monitor.relocalized().size());
+    run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double total = 0;
+    for (const myslam::Profiler::FrameRecord &record:vo->profiler_->records())
+        total += record.time[myslam::Profiler::TOTAL];
+    run.mean_ms = run.frames > 0 ? total / run.frames : 0;
+    run.p95_ms = vo->profiler_->percentile(myslam::Profiler::TOTAL, 95);
+    if (!sequence.groundtruth.empty()) {
+        myslam::Trajectory matched_estimated, matched_groundtruth;
+        myslam::associateTrajectories(estimated, sequence.groundtruth, 0.02, matched_estimated, matched_groundtruth);
+        run.ate = myslam::computeATE(matched_estimated, matched_groundtruth);
+        run.rpe = myslam::computeRPE(matched_estimated, matched_groundtruth);
+    }
+}
+
+int main(int argc, char **argv) {
+    vector<string> args;
+    vector<string> overrides = myslam::Config::overridesFromArgs(argc, argv, 1, &args);
+    if (args.size() < 2 || args.size() > 4) {
+        cout << "usage: sweep_vo parameter_file sweep_file [results_csv] [threads] [key=value ...]" << endl;
+        return 1;
+    }
+    if (!myslam::Config::setParameterFile(args[0], overrides))
+        return 1;
+    string results_file = args.size() > 2 ? args[2] : "sweep_results.csv";
+    int num_threads = args.size() > 3 ? atoi(args[3].c_str()) : int(thread::hardware_concurrency());
+    num_threads = max(num_threads, 1);
+
+    vector<Run> runs;
+    if (!readSweep(args[1], runs))
+        return 1;
+    for (Run &run:runs) {
+        run.parameters = myslam::Config::derive(run.overrides);
+        if (run.parameters == nullptr) {
+            cerr << "invalid configuration: " << run.label << endl;
+            return 1;
+        }
+    }
+
+    Sequence sequence;
+    if (!loadSequence(*myslam::Config::parameters(), sequence))
+        return 1;
+    cout << runs.size() << " runs over " << sequence.colors.size() << " frames on " << num_threads << " threads"
+         << endl;
+
+//    the runs are the parallelism, OpenCV's own thread pool would only compete with them
+    cv::setNumThreads(1);
+    atomic<size_t> next_run(0);
+    vector<thread> workers;
+    for (int t = 0; t < min<int>(num_threads, runs.size()); ++t) {
+        workers.emplace_back([&] {
+            for (size_t i = next_run++; i < runs.size(); i = next_run++)
+                runSession(sequence, runs[i]);
+        });
+    }
+    for (thread &worker:workers)
+        worker.join();
+
+    ofstream csv(results_file);
+    csv << "configuration,frames,tracked,lost,relocalized,seconds,mean_ms,p95_ms,ate_rmse,rpe_rmse,rpe_deg" << endl;
+    char line[256];
+    snprintf(line, sizeof(line), "%5s %6s %7s %7s %9s %9s %10s %10s %8s", "run", "frames", "tracked", "reloc",
+             "mean ms", "p95 ms", "ATE m", "RPE m", "RPE deg");
+    cout << line << endl;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const Run &run = runs[i];
+        snprintf(line, sizeof(line), "%5zu %6d %7d %7d %9.2f %9.2f %10.4f %10.4f %8.3f%s", i, run.frames,
+                 run.tracked, run.relocalized, run.mean_ms, run.p95_ms, run.ate.rmse, run.rpe.rmse,
+                 run.rpe.rot_rmse * 180 / M_PI, run.lost ? " lost" : "");
+        cout << line << "  " << run.label << endl;
+        csv << "\"" << run.label << "\"," << run.frames << "," << run.tracked << "," << run.lost << ","
+            << run.relocalized << "," << run.seconds << "," << run.mean_ms << "," << run.p95_ms << ","
+            << run.ate.rmse << "," << run.rpe.rmse << "," << run.rpe.rot_rmse * 180 / M_PI << endl;
+    }
+    if (!csv) {
+        cerr << "cannot write " << results_file << endl;
+        return 1;
+    }
+    cout << "results written to " << results_file << endl;
+    return 0;
+}
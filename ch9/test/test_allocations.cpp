@@ -0,0 +1,157 @@
+//
+// Created by Left Thomas on 2017/9/18.
+// counts the heap allocations the VO makes per frame once it is warmed up,
+// key-frames and tracked frames are reported apart since only the latter are meant to be allocation free
+//
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "myslam/config.h"
+#include "myslam/visual_odometry.h"
+#include "myslam/frame_pool.h"
+#include "myslam/dataset_reader.h"
+#include "myslam/sequence_pack.h"
+#include "myslam/tracking_monitor.h"
+
+using namespace std;
+
+//    only the thread running the VO counts, the decoders and the back end are left out
+static thread_local bool counting = false;
+static std::atomic<unsigned long> heap_allocations(0);
+static std::atomic<unsigned long> mat_allocations(0);
+
+void *operator new(size_t size) {
+    if (counting)
+        heap_allocations++;
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+//    forwards to the default allocator and counts the new Mat buffers
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    explicit CountingMatAllocator(cv::MatAllocator *base) : base_(base) {}
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, int flags,
+                           cv::UMatUsageFlags usage) const override {
+        if (counting && data == nullptr)
+            mat_allocations++;
+        return base_->allocate(dims, sizes, type, data, step, flags, usage);
+    }
+
+    bool allocate(cv::UMatData *data, int access, cv::UMatUsageFlags usage) const override {
+        return base_->allocate(data, access, usage);
+    }
+
+    void deallocate(cv::UMatData *data) const override {
+        base_->deallocate(data);
+    }
+
+private:
+    cv::MatAllocator *base_;
+};
+
+struct Tally {
+    int frames = 0;
+    unsigned long heap = 0, mats = 0, max_heap = 0;
+
+    void add(unsigned long h, unsigned long m) {
+        frames++;
+        heap += h;
+        mats += m;
+        max_heap = max(max_heap, h);
+    }
+
+    void print(const string &name) const {
+        if (frames == 0) {
+            cout << name << ": none" << endl;
+            return;
+        }
+        cout << name << ": " << frames << " frames, " << double(heap) / frames << " operator new and "
+             << double(mats) / frames << " Mat buffers per frame, at most " << max_heap << " operator new" << endl;
+    }
+};
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 4) {
+        cout << "usage: test_allocations parameter_file [warmup_frames] [max_allocations_per_tracked_frame]" << endl;
+        return 1;
+    }
+    if (!myslam::Config::setParameterFile(argv[1]))
+        return 1;
+    int warmup = argc > 2 ? atoi(argv[2]) : 30;
+    double max_allocations = argc > 3 ? atof(argv[3]) : -1;
+
+    static CountingMatAllocator mat_allocator(cv::Mat::getDefaultAllocator());
+    cv::Mat::setDefaultAllocator(&mat_allocator);
+
+    myslam::VisualOdometry::Ptr vo(new myslam::VisualOdometry);
+    myslam::Camera::Ptr camera(new myslam::Camera());
+    string dataset_pack = myslam::Config::parameters()->dataset_pack;
+    myslam::SequencePack::Ptr pack;
+    shared_ptr<myslam::DatasetReader> reader;
+    if (!dataset_pack.empty()) {
+        pack = myslam::SequencePack::open(dataset_pack);
+        if (pack == nullptr)
+            return 1;
+    } else {
+        reader.reset(new myslam::DatasetReader(myslam::Config::parameters()->dataset_dir));
+        if (!reader->isOpened())
+            return 1;
+    }
+
+//    frames are tracked one at a time in this thread, no pipeline in between
+    myslam::FramePool pool;
+    Tally tracked, key_frames;
+    myslam::TrackingMonitor monitor(vo->relocalizer_ != nullptr,
+                                    myslam::Config::parameters()->vo.reloc_max_lost_frames);
+    myslam::DatasetReader::Image image;
+    for (size_t i = 0;; ++i) {
+        myslam::Frame::Ptr frame = pool.acquire();
+        frame->camera_ = camera;
+        if (pack != nullptr) {
+            if (i >= pack->size())
+                break;
+            frame->time_stamp_ = pack->entry(i).time_stamp;
+            frame->color_ = pack->color(i);
+            frame->depth_ = pack->depth(i);
+        } else {
+            if (!reader->next(image))
+                break;
+            if (image.color.empty())
+                continue;
+            frame->time_stamp_ = image.time_stamp;
+            frame->color_ = image.color;
+            frame->depth_ = image.depth;
+        }
+
+        unsigned long heap_before = heap_allocations, mats_before = mat_allocations;
+        counting = true;
+        bool ok = vo->addFrame(frame);
+        counting = false;
+        if (!monitor.update(frame->id_, vo->state_)) {
+            cout << "vo lost at frame " << i << endl;
+            break;
+        }
+        if (!ok || int(i) < warmup)
+            continue;
+        (frame->is_key_frame_ ? key_frames : tracked).add(heap_allocations - heap_before,
+                                                          mat_allocations - mats_before);
+    }
+
+    monitor.printSummary(cout);
+    tracked.print("tracked frames");
+    key_frames.print("key-frames");
+    if (max_allocations >= 0 && tracked.frames > 0 && double(tracked.heap) / tracked.frames > max_allocations) {
+        cout << "more than " << max_allocations << " allocations per tracked frame" << endl;
+        return 2;
+    }
+    return 0;
+}
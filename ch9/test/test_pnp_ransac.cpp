@@ -0,0 +1,50 @@
+//
+// Created by Left Thomas on 2017/9/13.
+// PnPRansac must give back the pose the observations were made from, also when it rotates far from the
+// identity: the absolute T_c_w solved against world map points is not a small motion
+//
+#include <iostream>
+#include <random>
+#include "myslam/pnp_ransac.h"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    myslam::Camera::Ptr camera(new myslam::Camera(517.3f, 516.5f, 325.1f, 249.7f, 5000.0f));
+//    about 150 degrees around a tilted axis
+    const Vector3d rotation_vector = Vector3d(0.3, -0.8, 0.5).normalized() * 2.6;
+    const SE3 T_c_w(SO3::exp(rotation_vector), Vector3d(0.4, -0.2, 1.5));
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::normal_distribution<double> noise(0, 0.5);
+    vector<Vector3d> pts_3d;
+    vector<Vector2d> pts_2d;
+    while (pts_3d.size() < 200) {
+//        points in front of the camera, moved into the world frame
+        Vector3d p_c(2 * uniform(rng), 1.5 * uniform(rng), 3 + uniform(rng));
+        pts_3d.push_back(T_c_w.inverse() * p_c);
+        Vector2d pixel = camera->camera2pixel(p_c);
+//        a fifth of the matches are outliers
+        if (pts_3d.size() % 5 == 0)
+            pixel += Vector2d(100 * uniform(rng), 100 * uniform(rng));
+        else
+            pixel += Vector2d(noise(rng), noise(rng));
+        pts_2d.push_back(pixel);
+    }
+
+    myslam::PnPRansac ransac(200, 4.0, 0.99);
+    SE3 estimated;
+    vector<int> inliers;
+    int num_inliers = ransac.estimate(pts_3d, pts_2d, camera, nullptr, estimated, inliers);
+
+    Vector3d rotation_error = (estimated.so3() * T_c_w.so3().inverse()).log();
+    double translation_error = (estimated.translation() - T_c_w.translation()).norm();
+    cout << "inliers " << num_inliers << " of " << pts_3d.size() << ", rotation error " << rotation_error.norm()
+         << " rad, translation error " << translation_error << endl;
+    if (num_inliers < 150 || rotation_error.norm() > 1e-2 || translation_error > 1e-2) {
+        cerr << "PnPRansac did not recover the pose" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -4,44 +4,40 @@
 // 手动编译安装OpenCV3，不要通过brew install opencv安装，否则是没有viz模块的
 //
 #include<iostream>
-#include <fstream>
-#include <boost/timer.hpp>
+#include <thread>
+#include <atomic>
 #include <opencv2/viz.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include "myslam/config.h"
 #include "myslam/visual_odometry.h"
+#include "myslam/pipeline.h"
+#include "myslam/frame_pool.h"
+#include "myslam/dataset_reader.h"
+#include "myslam/tracking_monitor.h"
 
 using namespace std;
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        cout << "usage: test_slam parameter_file" << endl;
+    vector<string> args;
+    vector<string> overrides = myslam::Config::overridesFromArgs(argc, argv, 1, &args);
+    if (args.size() != 1) {
+        cout << "usage: test_slam parameter_file [key=value ...]" << endl;
         return 1;
     }
-    myslam::Config::setParameterFile(argv[1]);
+    if (!myslam::Config::setParameterFile(args[0], overrides))
+        return 1;
+    myslam::Parameters::ConstPtr parameters = myslam::Config::parameters();
     myslam::VisualOdometry::Ptr vo(new myslam::VisualOdometry);
 
-    string dataset_dir = myslam::Config::get<string>("dataset_dir");
+    string dataset_dir = parameters->dataset_dir;
     cout << "dataset: " << dataset_dir << endl;
-    ifstream fin(dataset_dir + "/associate.txt");
-    if (!fin) {
+//    the PNGs are decoded ahead of time on the reader's own threads
+    myslam::DatasetReader reader(dataset_dir, parameters->decode_threads, parameters->decode_queue_size);
+    if (!reader.isOpened()) {
         cout << "please generate the associate file called associate.txt!" << endl;
         return 1;
     }
 
-    vector<string> rgb_files, depth_files;
-    vector<double> rgb_times, depth_times;
-    while (!fin.eof()) {
-        string rgb_time, rgb_file, depth_time, depth_file;
-        fin >> rgb_time >> rgb_file >> depth_time >> depth_file;
-        rgb_times.push_back(atof(rgb_time.c_str()));
-        depth_times.push_back(atof(depth_time.c_str()));
-        rgb_files.push_back(dataset_dir + "/" + rgb_file);
-        depth_files.push_back(dataset_dir + "/" + depth_file);
-        if (!fin.good())
-            break;
-    }
-
     myslam::Camera::Ptr camera(new myslam::Camera());
 
 //    visualization
@@ -55,24 +51,57 @@ int main(int argc, char **argv) {
     vis.showWidget("World", world_coor);
     vis.showWidget("Camera", camera_coor);
 
-    cout << "read total " << rgb_files.size() << " entries" << endl;
-    for (int i = 0; i < rgb_files.size(); ++i) {
-        Mat color = cv::imread(rgb_files[i]);
-        Mat depth = cv::imread(depth_files[i], -1);
-        if (color.data == nullptr || depth.data == nullptr)
-            break;
-        myslam::Frame::Ptr pFrame = myslam::Frame::createFrame();
-        pFrame->camera_ = camera;
-        pFrame->color_ = color;
-        pFrame->depth_ = depth;
-        pFrame->time_stamp_ = rgb_times[i];
-        boost::timer timer;
-        vo->addFrame(pFrame);
-        cout << "VO costs time:" << timer.elapsed() * 1000 << " ms" << endl;
+    cout << "read total " << reader.size() << " entries" << endl;
+//    feature extraction runs ahead of tracking, results come back in frame order
+    myslam::Pipeline::Ptr pipeline(new myslam::Pipeline(vo, camera));
+    thread feeder([&] {
+//        more frames than the pipeline queues can hold, so a free one is always found
+        myslam::FramePool pool(64);
+        myslam::DatasetReader::Image image;
+        while (reader.next(image)) {
+            if (image.color.empty())
+                continue;
+            myslam::Frame::Ptr frame = pool.acquire();
+            frame->camera_ = camera;
+            frame->time_stamp_ = image.time_stamp;
+            frame->color_ = image.color;
+            frame->depth_ = image.depth;
+            if (!pipeline->push(frame))
+                break;
+        }
+        pipeline->finish();
+    });
 
-        if (vo->state_ == myslam::VisualOdometry::LOST)
-            break;
-        SE3 Tcw = pFrame->T_c_w_.inverse();
+//    results are drained on their own thread so a slow window never holds the tracker back,
+//    the window shows the newest published pose and frame whenever it gets to it
+    std::atomic<bool> finished(false);
+    myslam::Frame::Ptr latest_frame;
+    myslam::TrackingMonitor monitor(vo->relocalizer_ != nullptr, parameters->vo.reloc_max_lost_frames);
+    thread drainer([&] {
+        myslam::Pipeline::Result result;
+        while (pipeline->pop(result)) {
+            cout << "VO costs time:" << result.track_time << " ms (match "
+                 << result.timing.time[myslam::Profiler::MATCH] << " ms, pnp "
+                 << result.timing.time[myslam::Profiler::PNP] << " ms, refine "
+                 << result.timing.time[myslam::Profiler::REFINE] << " ms)" << endl;
+            if (!monitor.update(result.frame->id_, result.state))
+                break;
+            std::atomic_store(&latest_frame, result.frame);
+        }
+        pipeline->finish();
+        finished = true;
+    });
+
+//    viz has to run on the main thread
+    unsigned long shown = 0;
+    myslam::PoseUpdate update;
+    while (!finished) {
+        if (vo->publisher_->published() == shown || !vo->publisher_->latest(update)) {
+            vis.spinOnce(1, false);
+            continue;
+        }
+        shown = vo->publisher_->published();
+        SE3 Tcw = update.pose().inverse();
 
 //        show the map and the camera pose
         cv::Affine3d M{static_cast<const Mat &>(cv::Affine3d::Mat3{
@@ -81,10 +110,28 @@ int main(int argc, char **argv) {
                 Tcw.rotation_matrix()(2, 0), Tcw.rotation_matrix()(2, 1), Tcw.rotation_matrix()(2, 2),}),
                        cv::Affine3d::Vec3(Tcw.translation()(0, 0), Tcw.translation()(1, 0), Tcw.translation()(2, 0))
         };
-        cv::imshow("image", color);
-        cv::waitKey(1);
+        myslam::Frame::Ptr frame = std::atomic_load(&latest_frame);
+        if (frame != nullptr)
+            cv::imshow("image", frame->color_);
+//        r reads the parameter file again, the tracker picks up the new thresholds at its next frame
+        if (cv::waitKey(1) == 'r' && myslam::Config::reload())
+            vo->updateParameters(myslam::Config::parameters()->vo);
         vis.setWidgetPose("Camera", M);
         vis.spinOnce(1, false);
     }
+    drainer.join();
+    pipeline->finish();
+    feeder.join();
+//    the tracking thread is joined before its timings are read
+    pipeline.reset();
+
+    monitor.printSummary(cout);
+    vo->profiler_->printSummary(cout);
+    const string &profile_csv = parameters->profile_csv;
+    const string &profile_json = parameters->profile_json;
+    if (!profile_csv.empty())
+        vo->profiler_->writeCSV(profile_csv);
+    if (!profile_json.empty())
+        vo->profiler_->writeJSON(profile_json);
     return 0;
 }